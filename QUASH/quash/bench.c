@@ -0,0 +1,312 @@
+/**
+ * @file bench.c
+ *
+ * Quash benchmark harness. Runs ./quash on generated scripts and reports
+ * startup time, builtin latency, fork/exec latency, pipeline throughput,
+ * parse throughput, background job fan-out and coprocess round trips as
+ * CSV. Given a baseline CSV from an earlier run it prints the change of
+ * every metric and fails if any got worse by more than the allowed
+ * percentage.
+ *
+ * Usage: quashbench [-q quash] [-r runs] [-o results.csv] [-b baseline.csv]
+ *                   [-t percent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define MAX_RESULTS (64)
+
+/**
+ * One measured metric. Lower is better for "ns/op"; higher is better for
+ * everything else.
+ */
+typedef struct result_t {
+    char name[64];
+    int param;
+    int runs;
+    double value;
+    char metric[16];
+} result_t;
+
+static const char * quash = "./quash";
+static char scratch[] = "/tmp/quashbench.XXXXXX";
+static int runs = 5;
+static result_t results[MAX_RESULTS];
+static int numResults = 0;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void * a, const void * b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Writes a script made of header, count copies of line and "quit". line may
+ * hold several commands separated by newlines.
+ *
+ * @return the path of the script
+ */
+static const char * write_script(const char * name, const char * header,
+                                 const char * line, int count)
+{
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", scratch, name);
+
+    FILE * f = fopen(path, "w");
+    if (header != NULL)
+        fprintf(f, "%s\n", header);
+    for (int i = 0; i < count; i++)
+        fprintf(f, "%s\n", line);
+    fprintf(f, "quit\n");
+    fclose(f);
+
+    return path;
+}
+
+/**
+ * Runs quash with script on stdin and its output discarded.
+ *
+ * @return the wall time in nanoseconds
+ */
+static double run_script(const char * script)
+{
+    double start = now_ns();
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        int in = open(script, O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        dup2(in, 0);
+        dup2(out, 1);
+        dup2(out, 2);
+        execl(quash, quash, (char *)NULL);
+        _exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s failed on %s\n", quash, script);
+        exit(EXIT_FAILURE);
+    }
+
+    return now_ns() - start;
+}
+
+/**
+ * Runs script runs times. The fastest run is the one least disturbed by the
+ * rest of the machine, which keeps results comparable between runs.
+ *
+ * @return the minimum wall time in nanoseconds
+ */
+static double min_run(const char * script)
+{
+    double times[runs];
+
+    for (int i = 0; i < runs; i++)
+        times[i] = run_script(script);
+
+    qsort(times, runs, sizeof(double), compare_doubles);
+    return times[0];
+}
+
+static void record(const char * name, int param, double value, const char * metric)
+{
+    result_t * r = &results[numResults++];
+
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->param = param;
+    r->runs = runs;
+    r->value = value;
+    snprintf(r->metric, sizeof(r->metric), "%s", metric);
+}
+
+static void bench_all()
+{
+    char line[4096];
+
+    double startup = min_run(write_script("startup", NULL, "", 0));
+    record("startup", 0, startup, "ns/op");
+
+    const int ops = 2000;
+
+    double builtin = min_run(write_script("builtin", NULL, "pwd", ops * 10));
+    record("builtin_latency", ops * 10, (builtin - startup) / (ops * 10), "ns/op");
+
+    double forkExec = min_run(write_script("forkexec", NULL, "/bin/true", ops / 4));
+    record("fork_exec_latency", ops / 4, (forkExec - startup) / (ops / 4), "ns/op");
+
+    // 64 MB through a three stage pipeline
+    const int mb = 64;
+    snprintf(line, sizeof(line), "%s/data", scratch);
+    FILE * f = fopen(line, "w");
+    char block[1 << 16];
+    memset(block, 'q', sizeof(block));
+    for (int i = 0; i < mb * 16; i++)
+        fwrite(block, 1, sizeof(block), f);
+    fclose(f);
+
+    char pipeline[600];
+    snprintf(pipeline, sizeof(pipeline), "cat %s/data | cat | wc -c", scratch);
+    double pipe = min_run(write_script("pipeline", NULL, pipeline, 1));
+    record("pipeline_throughput", mb, mb / ((pipe - startup) / 1e9), "MB/s");
+
+    // Long builtin lines are dominated by tokenizing. 100 arguments keep the
+    // line at 904 characters, inside quash's 1024 byte line buffer.
+    strcpy(line, "echo");
+    for (int i = 0; i < 100; i++)
+        strcat(line, " argument");
+    double parse = min_run(write_script("parse", NULL, line, ops));
+    record("parse_throughput", ops, ops / ((parse - startup) / 1e9), "lines/s");
+
+    const int fanouts[] = {1, 10, 100, 1000};
+    for (int i = 0; i < 4; i++)
+    {
+        double fan = min_run(write_script("fanout", NULL, "/bin/true&", fanouts[i]));
+        record("bg_fanout", fanouts[i], (fan - startup) / fanouts[i], "ns/op");
+    }
+
+    // The same request answered by one long-lived cat and by a new process each time
+    double coproc = min_run(write_script("coproc", "coproc c /bin/cat", "send c request\nrecv c", ops / 4));
+    double coprocStart = min_run(write_script("coprocstart", "coproc c /bin/cat", "", 0));
+    double perCall = (coproc - coprocStart) / (ops / 4);
+    record("coproc_call_latency", ops / 4, perCall, "ns/op");
+
+    double exec = min_run(write_script("execcall", NULL, "/bin/echo request", ops / 4));
+    double perExec = (exec - startup) / (ops / 4);
+    record("exec_call_latency", ops / 4, perExec, "ns/op");
+    record("coproc_speedup", ops / 4, perExec / perCall, "x");
+}
+
+static void write_results(FILE * out)
+{
+    fprintf(out, "benchmark,param,runs,value,metric\n");
+    for (int i = 0; i < numResults; i++)
+        fprintf(out, "%s,%d,%d,%.1f,%s\n", results[i].name, results[i].param,
+                results[i].runs, results[i].value, results[i].metric);
+}
+
+/**
+ * Compares the results with a baseline CSV.
+ *
+ * @return the number of metrics worse than the baseline by more than
+ *         threshold percent
+ */
+static int compare(const char * baseline, double threshold)
+{
+    FILE * f = fopen(baseline, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Unable to open baseline \"%s\".\n", baseline);
+        return 0;
+    }
+
+    char line[256];
+    int regressions = 0;
+
+    fgets(line, sizeof(line), f); // header
+    printf("%-22s %6s %14s %14s %8s\n", "benchmark", "param", "baseline", "current", "change");
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char name[64], metric[16];
+        int param, baseRuns;
+        double value;
+
+        if (sscanf(line, "%63[^,],%d,%d,%lf,%15s", name, &param, &baseRuns, &value, metric) != 5)
+            continue;
+
+        for (int i = 0; i < numResults; i++)
+        {
+            if (strcmp(results[i].name, name) || results[i].param != param)
+                continue;
+
+            double change = (results[i].value - value) / value * 100.0;
+            bool lowerIsBetter = !strcmp(metric, "ns/op");
+            double worse = lowerIsBetter ? change : -change;
+            bool regressed = worse > threshold;
+
+            printf("%-22s %6d %14.1f %14.1f %+7.1f%%%s\n", name, param, value,
+                   results[i].value, change, regressed ? "  REGRESSED" : "");
+            regressions += regressed;
+        }
+    }
+
+    fclose(f);
+    return regressions;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * output = NULL;
+    const char * baseline = NULL;
+    double threshold = 10.0;
+    int c;
+
+    while ((c = getopt(argc, argv, "q:r:o:b:t:")) != -1)
+    {
+        switch (c)
+        {
+        case 'q': quash = optarg; break;
+        case 'r': runs = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'o': output = optarg; break;
+        case 'b': baseline = optarg; break;
+        case 't': threshold = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-q quash] [-r runs] [-o results.csv] "
+                    "[-b baseline.csv] [-t percent]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (mkdtemp(scratch) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    // Keep benchmark runs out of the user's history file
+    char hist[600];
+    snprintf(hist, sizeof(hist), "%s/history", scratch);
+    setenv("HISTFILE", hist, 1);
+
+    bench_all();
+
+    write_results(stdout);
+    if (output != NULL)
+    {
+        FILE * out = fopen(output, "w");
+        write_results(out);
+        fclose(out);
+    }
+
+    int regressions = 0;
+    if (baseline != NULL)
+    {
+        printf("\n");
+        regressions = compare(baseline, threshold);
+    }
+
+    char cleanup[600];
+    snprintf(cleanup, sizeof(cleanup), "rm -rf %s", scratch);
+    system(cleanup);
+
+    return regressions > 0 ? 2 : 0;
+}
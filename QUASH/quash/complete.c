@@ -0,0 +1,402 @@
+/**
+ * @file complete.c
+ *
+ * Command names live in a trie stored in one node array, with each node's
+ * children kept as a sibling list sorted by character so a depth first walk
+ * yields names in order. The trie for $PATH is built by a detached thread
+ * and swapped in when it finishes; a generation counter discards builds
+ * started before the last PATH change. File names come from the sorted
+ * directory listings cached by glob_expand.c.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "complete.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+/**
+ * One trie node. Index 0 is the root, so 0 also means "no node".
+ */
+typedef struct trie_node_t {
+    uint32_t child;   ///< first child
+    uint32_t sibling; ///< next node with the same parent, in character order
+    unsigned char c;
+    bool terminal;    ///< a name ends here
+} trie_node_t;
+
+typedef struct trie_t {
+    trie_node_t * nodes;
+    uint32_t count;
+    uint32_t cap;
+} trie_t;
+
+/**
+ * What a background $PATH scan is asked to do.
+ */
+typedef struct scan_job_t {
+    unsigned generation;
+    char * path;
+} scan_job_t;
+
+static pthread_mutex_t trieLock = PTHREAD_MUTEX_INITIALIZER;
+static trie_t * pathTrie = NULL;    ///< builtins and $PATH, once scanned
+static trie_t * builtinTrie = NULL; ///< builtins only, used until then
+static unsigned generation = 0;
+static const char * const * builtinNames = NULL;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static trie_t * trie_new()
+{
+    trie_t * t = malloc(sizeof(trie_t));
+
+    t->cap = 1024;
+    t->count = 1;
+    t->nodes = malloc(t->cap * sizeof(trie_node_t));
+    memset(&t->nodes[0], 0, sizeof(trie_node_t));
+
+    return t;
+}
+
+static void trie_free(trie_t * t)
+{
+    if (t == NULL)
+        return;
+
+    free(t->nodes);
+    free(t);
+}
+
+static uint32_t trie_child(const trie_t * t, uint32_t node, unsigned char c)
+{
+    uint32_t n = t->nodes[node].child;
+
+    while (n != 0 && t->nodes[n].c < c)
+        n = t->nodes[n].sibling;
+
+    return (n != 0 && t->nodes[n].c == c) ? n : 0;
+}
+
+static void trie_insert(trie_t * t, const char * name)
+{
+    uint32_t node = 0;
+
+    for (const unsigned char * p = (const unsigned char *)name; *p; p++)
+    {
+        uint32_t prev = 0;
+        uint32_t n = t->nodes[node].child;
+
+        while (n != 0 && t->nodes[n].c < *p)
+        {
+            prev = n;
+            n = t->nodes[n].sibling;
+        }
+
+        if (n == 0 || t->nodes[n].c != *p)
+        {
+            if (t->count == t->cap)
+            {
+                t->cap *= 2;
+                t->nodes = realloc(t->nodes, t->cap * sizeof(trie_node_t));
+            }
+
+            uint32_t created = t->count++;
+            t->nodes[created].child = 0;
+            t->nodes[created].sibling = n;
+            t->nodes[created].c = *p;
+            t->nodes[created].terminal = false;
+
+            if (prev == 0)
+                t->nodes[node].child = created;
+            else
+                t->nodes[prev].sibling = created;
+            n = created;
+        }
+
+        node = n;
+    }
+
+    t->nodes[node].terminal = true;
+}
+
+/**
+ * Adds up to max names below node to matches, each prefixed with buf.
+ *
+ * @return the number of names found, at most max
+ */
+static int trie_collect(const trie_t * t, uint32_t node, char * buf, size_t len,
+                        size_t size, glob_list_t * matches, int max)
+{
+    int found = 0;
+
+    if (t->nodes[node].terminal)
+    {
+        buf[len] = '\0';
+        if (matches != NULL)
+        {
+            if (matches->count == matches->cap)
+            {
+                matches->cap = matches->cap ? matches->cap * 2 : 16;
+                matches->paths = realloc(matches->paths, matches->cap * sizeof(char *));
+            }
+            matches->paths[matches->count++] = strdup(buf);
+        }
+        found++;
+    }
+
+    for (uint32_t n = t->nodes[node].child; n != 0 && found < max && len + 1 < size;
+         n = t->nodes[n].sibling)
+    {
+        buf[len] = t->nodes[n].c;
+        found += trie_collect(t, n, buf, len + 1, size, matches, max - found);
+    }
+
+    return found;
+}
+
+static trie_t * builtin_trie()
+{
+    trie_t * t = trie_new();
+
+    for (int i = 0; builtinNames != NULL && builtinNames[i] != NULL; i++)
+        trie_insert(t, builtinNames[i]);
+
+    return t;
+}
+
+static void * scan_path(void * arg)
+{
+    scan_job_t * job = arg;
+    trie_t * t = builtin_trie();
+    char * save = NULL;
+    char full[4096];
+
+    for (char * dir = strtok_r(job->path, ":", &save); dir != NULL;
+         dir = strtok_r(NULL, ":", &save))
+    {
+        DIR * dp = opendir(dir);
+        if (dp == NULL)
+            continue;
+
+        struct dirent * de;
+        while ((de = readdir(dp)) != NULL)
+        {
+            if (de->d_name[0] == '.')
+                continue;
+            if (de->d_type != DT_REG && de->d_type != DT_LNK && de->d_type != DT_UNKNOWN)
+                continue;
+
+            snprintf(full, sizeof(full), "%s/%s", dir, de->d_name);
+            if (access(full, X_OK) == 0)
+                trie_insert(t, de->d_name);
+        }
+        closedir(dp);
+    }
+
+    pthread_mutex_lock(&trieLock);
+    if (job->generation == generation)
+    {
+        trie_free(pathTrie);
+        pathTrie = t;
+        t = NULL;
+    }
+    pthread_mutex_unlock(&trieLock);
+
+    trie_free(t);
+    free(job->path);
+    free(job);
+    return NULL;
+}
+
+static void start_scan()
+{
+    const char * path = getenv("PATH");
+    scan_job_t * job = malloc(sizeof(scan_job_t));
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_mutex_lock(&trieLock);
+    job->generation = ++generation;
+    trie_free(pathTrie);
+    pathTrie = NULL;
+    pthread_mutex_unlock(&trieLock);
+
+    job->path = strdup(path != NULL ? path : "");
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, scan_path, job) != 0)
+        scan_path(job);
+    pthread_attr_destroy(&attr);
+}
+
+static int complete_command(const char * word, char * ext, size_t extlen,
+                            glob_list_t * matches, int max)
+{
+    char buf[4096];
+    size_t wlen = strlen(word);
+    size_t e = 0;
+    int found = 0;
+
+    pthread_mutex_lock(&trieLock);
+    const trie_t * t = pathTrie != NULL ? pathTrie : builtinTrie;
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < wlen && (i == 0 || node != 0); i++)
+        node = trie_child(t, node, word[i]);
+
+    if (wlen == 0 || node != 0)
+    {
+        // Extend while there is exactly one way to continue
+        uint32_t n = node;
+        while (!t->nodes[n].terminal && t->nodes[n].child != 0 &&
+               t->nodes[t->nodes[n].child].sibling == 0 && e + 2 < extlen)
+        {
+            n = t->nodes[n].child;
+            ext[e++] = t->nodes[n].c;
+        }
+
+        if (wlen < sizeof(buf))
+        {
+            memcpy(buf, word, wlen);
+            found = trie_collect(t, node, buf, wlen, sizeof(buf), matches, max);
+        }
+
+        if (found == 1 && e + 1 < extlen)
+            ext[e++] = ' ';
+    }
+    pthread_mutex_unlock(&trieLock);
+
+    ext[e] = '\0';
+    return found;
+}
+
+static int complete_file(const char * word, char * ext, size_t extlen,
+                         glob_list_t * matches, int max)
+{
+    const char * slash = strrchr(word, '/');
+    const char * base = slash ? slash + 1 : word;
+    size_t blen = strlen(base);
+    char dir[4096];
+
+    ext[0] = '\0';
+
+    if (slash == NULL)
+        strcpy(dir, ".");
+    else if (slash == word)
+        strcpy(dir, "/");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - word), word);
+
+    const dir_listing_t * listing = dir_cache_lookup(dir);
+    if (listing == NULL)
+        return 0;
+
+    // Names are sorted, so the candidates are one contiguous run
+    int lo = 0, hi = listing->count;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(listing->names[mid], base, blen) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int found = 0;
+    int first = -1;
+    size_t common = 0;
+
+    for (int i = lo; i < listing->count && !strncmp(listing->names[i], base, blen); i++)
+    {
+        const char * name = listing->names[i];
+
+        if (name[0] == '.' && base[0] != '.')
+            continue;
+
+        if (first < 0)
+        {
+            first = i;
+            common = strlen(name);
+        }
+        else
+        {
+            size_t k = blen;
+            while (k < common && name[k] == listing->names[first][k])
+                k++;
+            common = k;
+        }
+
+        if (matches != NULL && found < max)
+        {
+            char path[4096];
+            snprintf(path, sizeof(path), "%.*s%s", (int)(base - word), word, name);
+
+            if (matches->count == matches->cap)
+            {
+                matches->cap = matches->cap ? matches->cap * 2 : 16;
+                matches->paths = realloc(matches->paths, matches->cap * sizeof(char *));
+            }
+            matches->paths[matches->count++] = strdup(path);
+        }
+        found++;
+    }
+
+    if (first < 0)
+        return 0;
+
+    size_t e = common - blen < extlen - 2 ? common - blen : extlen - 2;
+    memcpy(ext, listing->names[first] + blen, e);
+
+    if (found == 1)
+    {
+        char path[sizeof(dir) + 256];
+        struct stat st;
+        unsigned char type = listing->types[first];
+
+        snprintf(path, sizeof(path), "%s/%s", dir, listing->names[first]);
+        bool isDir = type == DT_DIR ||
+            ((type == DT_LNK || type == DT_UNKNOWN) && stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+        ext[e++] = isDir ? '/' : ' ';
+    }
+    ext[e] = '\0';
+
+    return found < max ? found : max;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+void complete_init(const char * const * builtins)
+{
+    builtinNames = builtins;
+    builtinTrie = builtin_trie();
+    start_scan();
+}
+
+void complete_invalidate()
+{
+    start_scan();
+}
+
+int complete_word(const char * word, bool command, char * ext, size_t extlen,
+                  glob_list_t * matches, int max)
+{
+    if (command && strchr(word, '/') == NULL)
+        return complete_command(word, ext, extlen, matches, max);
+
+    return complete_file(word, ext, extlen, matches, max);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file complete.h
+ *
+ * Tab completion over builtins, the executables on $PATH and files.
+ */
+
+#ifndef COMPLETE_H
+#define COMPLETE_H
+
+#include "glob_expand.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Registers the builtin names and starts scanning $PATH in the background.
+ *
+ * @param builtins - NULL terminated list of builtin command names
+ */
+void complete_init(const char * const * builtins);
+
+/**
+ * Discards the executable trie and rescans $PATH in the background. Call it
+ * whenever PATH changes.
+ */
+void complete_invalidate();
+
+/**
+ * Completes word, a command name if command is set and a path otherwise.
+ *
+ * @param word - the partial word before the cursor
+ * @param command - True if word is in command position
+ * @param ext - receives the text every candidate continues word with
+ * @param extlen - size of ext
+ * @param matches - if not NULL, receives up to max full candidates, sorted
+ * @param max - most candidates to put in matches
+ * @return the number of candidates, or max if there are at least that many
+ */
+int complete_word(const char * word, bool command, char * ext, size_t extlen,
+                  glob_list_t * matches, int max);
+
+#endif // COMPLETE_H
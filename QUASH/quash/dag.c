@@ -0,0 +1,268 @@
+/**
+ * @file dag.c
+ *
+ * Edges are made as resources are recorded: a read waits for the last
+ * writer of the resource, and a write waits for the last writer and every
+ * reader since it. Each node counts its unfinished dependencies; nodes that
+ * reach zero go on a min-heap so ready work is started in script order.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "dag.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+typedef struct int_list_t {
+    int * items;
+    int count;
+    int cap;
+} int_list_t;
+
+typedef struct dag_node_t {
+    int pending;      ///< dependencies not yet done
+    int_list_t succ;  ///< nodes waiting on this one
+    bool barrier;
+    bool done;
+} dag_node_t;
+
+/**
+ * A file or descriptor touched by script lines.
+ */
+typedef struct resource_t {
+    char * name;        ///< NULL for an empty slot
+    int lastWriter;     ///< -1 if never written
+    int_list_t readers; ///< readers since lastWriter
+} resource_t;
+
+struct dag_t {
+    dag_node_t * nodes;
+    int count;
+    int cap;
+    int lastBarrier;    ///< -1 if there is none yet
+    resource_t * resources;
+    int numResources;
+    int resourceCap;    ///< power of two
+    int_list_t ready;   ///< min-heap of ready node indexes
+    int scanned;        ///< nodes checked for readiness without dependencies
+};
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void list_push(int_list_t * l, int value)
+{
+    if (l->count == l->cap)
+    {
+        l->cap = l->cap ? l->cap * 2 : 4;
+        l->items = realloc(l->items, l->cap * sizeof(int));
+    }
+    l->items[l->count++] = value;
+}
+
+static void heap_push(int_list_t * heap, int value)
+{
+    list_push(heap, value);
+
+    int i = heap->count - 1;
+    while (i > 0 && heap->items[(i - 1) / 2] > heap->items[i])
+    {
+        int parent = (i - 1) / 2;
+        int tmp = heap->items[parent];
+        heap->items[parent] = heap->items[i];
+        heap->items[i] = tmp;
+        i = parent;
+    }
+}
+
+static int heap_pop(int_list_t * heap)
+{
+    int top = heap->items[0];
+    heap->items[0] = heap->items[--heap->count];
+
+    int i = 0;
+    for (;;)
+    {
+        int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < heap->count && heap->items[l] < heap->items[smallest])
+            smallest = l;
+        if (r < heap->count && heap->items[r] < heap->items[smallest])
+            smallest = r;
+        if (smallest == i)
+            break;
+
+        int tmp = heap->items[smallest];
+        heap->items[smallest] = heap->items[i];
+        heap->items[i] = tmp;
+        i = smallest;
+    }
+    return top;
+}
+
+static void add_edge(dag_t * dag, int from, int to)
+{
+    if (from < 0 || from == to || dag->nodes[from].done)
+        return;
+
+    // Consecutive edges between the same pair are common and harmless to skip
+    int_list_t * succ = &dag->nodes[from].succ;
+    if (succ->count > 0 && succ->items[succ->count - 1] == to)
+        return;
+
+    list_push(succ, to);
+    dag->nodes[to].pending++;
+}
+
+static uint32_t hash_name(const char * s)
+{
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static resource_t * resource_get(dag_t * dag, const char * name)
+{
+    if (2 * (dag->numResources + 1) > dag->resourceCap)
+    {
+        resource_t * old = dag->resources;
+        int oldCap = dag->resourceCap;
+
+        dag->resourceCap = oldCap ? oldCap * 2 : 64;
+        dag->resources = calloc(dag->resourceCap, sizeof(resource_t));
+
+        for (int i = 0; i < oldCap; i++)
+        {
+            if (old[i].name == NULL)
+                continue;
+
+            uint32_t j = hash_name(old[i].name) & (dag->resourceCap - 1);
+            while (dag->resources[j].name != NULL)
+                j = (j + 1) & (dag->resourceCap - 1);
+            dag->resources[j] = old[i];
+        }
+        free(old);
+    }
+
+    uint32_t i = hash_name(name) & (dag->resourceCap - 1);
+    while (dag->resources[i].name != NULL)
+    {
+        if (!strcmp(dag->resources[i].name, name))
+            return &dag->resources[i];
+        i = (i + 1) & (dag->resourceCap - 1);
+    }
+
+    resource_t * r = &dag->resources[i];
+    r->name = strdup(name);
+    r->lastWriter = -1;
+    memset(&r->readers, 0, sizeof(r->readers));
+    dag->numResources++;
+    return r;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+dag_t * dag_create()
+{
+    dag_t * dag = calloc(1, sizeof(dag_t));
+    dag->lastBarrier = -1;
+    return dag;
+}
+
+void dag_destroy(dag_t * dag)
+{
+    for (int i = 0; i < dag->count; i++)
+        free(dag->nodes[i].succ.items);
+
+    for (int i = 0; i < dag->resourceCap; i++)
+    {
+        free(dag->resources[i].name);
+        free(dag->resources[i].readers.items);
+    }
+
+    free(dag->nodes);
+    free(dag->resources);
+    free(dag->ready.items);
+    free(dag);
+}
+
+int dag_add_node(dag_t * dag, bool barrier)
+{
+    if (dag->count == dag->cap)
+    {
+        dag->cap = dag->cap ? dag->cap * 2 : 64;
+        dag->nodes = realloc(dag->nodes, dag->cap * sizeof(dag_node_t));
+    }
+
+    int node = dag->count++;
+    memset(&dag->nodes[node], 0, sizeof(dag_node_t));
+    dag->nodes[node].barrier = barrier;
+
+    if (barrier)
+    {
+        for (int i = dag->lastBarrier < 0 ? 0 : dag->lastBarrier; i < node; i++)
+            add_edge(dag, i, node);
+        dag->lastBarrier = node;
+    }
+    else
+        add_edge(dag, dag->lastBarrier, node);
+
+    return node;
+}
+
+void dag_read(dag_t * dag, const char * resource)
+{
+    int node = dag->count - 1;
+    resource_t * r = resource_get(dag, resource);
+
+    add_edge(dag, r->lastWriter, node);
+    list_push(&r->readers, node);
+}
+
+void dag_write(dag_t * dag, const char * resource)
+{
+    int node = dag->count - 1;
+    resource_t * r = resource_get(dag, resource);
+
+    add_edge(dag, r->lastWriter, node);
+    for (int i = 0; i < r->readers.count; i++)
+        add_edge(dag, r->readers.items[i], node);
+
+    r->lastWriter = node;
+    r->readers.count = 0;
+}
+
+bool dag_is_barrier(const dag_t * dag, int node)
+{
+    return dag->nodes[node].barrier;
+}
+
+int dag_next_ready(dag_t * dag)
+{
+    // Nodes are only complete once the next one is added or scheduling starts
+    for (; dag->scanned < dag->count; dag->scanned++)
+        if (dag->nodes[dag->scanned].pending == 0)
+            heap_push(&dag->ready, dag->scanned);
+
+    return dag->ready.count > 0 ? heap_pop(&dag->ready) : -1;
+}
+
+void dag_done(dag_t * dag, int node)
+{
+    dag_node_t * n = &dag->nodes[node];
+    n->done = true;
+
+    for (int i = 0; i < n->succ.count; i++)
+    {
+        int next = n->succ.items[i];
+        if (--dag->nodes[next].pending == 0 && next < dag->scanned)
+            heap_push(&dag->ready, next);
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file dag.h
+ *
+ * Dependency graph of script lines for parallel execution. Nodes are added
+ * in script order along with the files they read and write, and an edge is
+ * made whenever two nodes touch the same file and at least one writes it.
+ */
+
+#ifndef DAG_H
+#define DAG_H
+
+#include <stdbool.h>
+
+typedef struct dag_t dag_t;
+
+/**
+ * Makes an empty graph.
+ */
+dag_t * dag_create();
+
+/**
+ * Frees a graph.
+ */
+void dag_destroy(dag_t * dag);
+
+/**
+ * Adds the next script line. A barrier waits for every earlier node and
+ * every later node waits for it.
+ *
+ * @return the node's index, counting from 0
+ */
+int dag_add_node(dag_t * dag, bool barrier);
+
+/**
+ * Records that the last added node reads resource.
+ */
+void dag_read(dag_t * dag, const char * resource);
+
+/**
+ * Records that the last added node writes resource.
+ */
+void dag_write(dag_t * dag, const char * resource);
+
+/**
+ * Checks if a node is a barrier.
+ */
+bool dag_is_barrier(const dag_t * dag, int node);
+
+/**
+ * Takes the lowest numbered node whose dependencies are all done.
+ *
+ * @return the node or -1 if none is ready
+ */
+int dag_next_ready(dag_t * dag);
+
+/**
+ * Marks a node done, which may make the nodes waiting on it ready.
+ */
+void dag_done(dag_t * dag, int node);
+
+#endif // DAG_H
@@ -0,0 +1,650 @@
+/**
+ * @file glob_expand.c
+ *
+ * Pathname expansion. Each path component of a pattern is compiled into a
+ * bit-parallel NFA, directory listings are cached by (dev, ino, mtime) and
+ * results are sorted with an MSD radix sort.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "glob_expand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+/// Number of hash buckets in the directory cache
+#define DIR_CACHE_BUCKETS (256)
+/// Number of cached directories before the whole cache is dropped
+#define DIR_CACHE_MAX (1024)
+/// Buckets at or below this size are insertion sorted
+#define RADIX_CUTOFF (32)
+
+/**
+ * One cached directory listing.
+ */
+typedef struct dir_cache_entry_t {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    dir_listing_t listing;
+    char * blob; ///< [d_type][name\0] records the listing points into
+    struct dir_cache_entry_t * next;
+} dir_cache_entry_t;
+
+static dir_cache_entry_t * dir_cache[DIR_CACHE_BUCKETS];
+static int dir_cache_count = 0;
+
+/**
+ * A path component compiled to an NFA simulated with bitsets. State i is
+ * "about to match token i"; state #glob_nfa_t.ntokens is the accept state.
+ */
+typedef struct glob_nfa_t {
+    int ntokens;
+    int words;          ///< 64 bit words per state set
+    uint64_t * star;    ///< states that are `*` tokens
+    uint64_t * accept;  ///< 256 state sets: states that may consume a byte
+    bool leading_dot;   ///< the component itself starts with a literal '.'
+} glob_nfa_t;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void insertion_sort(char ** strs, size_t n, size_t depth)
+{
+    for (size_t i = 1; i < n; i++)
+    {
+        char * key = strs[i];
+        size_t j = i;
+
+        while (j > 0 && strcmp(strs[j-1] + depth, key + depth) > 0)
+        {
+            strs[j] = strs[j-1];
+            j--;
+        }
+        strs[j] = key;
+    }
+}
+
+static void radix_sort(char ** strs, char ** tmp, size_t n, size_t depth)
+{
+    if (n <= RADIX_CUTOFF)
+    {
+        insertion_sort(strs, n, depth);
+        return;
+    }
+
+    size_t count[257] = {0};
+
+    for (size_t i = 0; i < n; i++)
+        count[(unsigned char)strs[i][depth] + 1]++;
+
+    for (int c = 1; c < 257; c++)
+        count[c] += count[c-1];
+
+    size_t start[256];
+    memcpy(start, count, sizeof(start));
+
+    for (size_t i = 0; i < n; i++)
+        tmp[count[(unsigned char)strs[i][depth]]++] = strs[i];
+
+    memcpy(strs, tmp, n * sizeof(char *));
+
+    // Bucket 0 holds strings that ended at depth and is already in order
+    for (int c = 1; c < 256; c++)
+    {
+        size_t len = count[c] - start[c];
+        if (len > 1)
+            radix_sort(strs + start[c], tmp, len, depth + 1);
+    }
+}
+
+static void list_push(glob_list_t * list, char * path)
+{
+    if (list->count == list->cap)
+    {
+        list->cap = list->cap ? list->cap * 2 : 16;
+        list->paths = realloc(list->paths, list->cap * sizeof(char *));
+    }
+    list->paths[list->count++] = path;
+}
+
+static char * path_join(const char * prefix, const char * name, size_t len)
+{
+    size_t plen = strlen(prefix);
+    bool slash = plen > 0 && prefix[plen-1] != '/';
+    char * path = malloc(plen + slash + len + 1);
+
+    memcpy(path, prefix, plen);
+    if (slash)
+        path[plen] = '/';
+    memcpy(path + plen + slash, name, len);
+    path[plen + slash + len] = '\0';
+
+    return path;
+}
+
+static void set_bit(uint64_t * set, int bit)
+{
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static bool nfa_compile(glob_nfa_t * nfa, const char * comp, size_t len)
+{
+    // A component has at most len tokens; size the sets for that many
+    nfa->words = (int)(len + 1) / 64 + 1;
+    nfa->star = calloc(nfa->words, sizeof(uint64_t));
+    nfa->accept = calloc(256 * nfa->words, sizeof(uint64_t));
+    nfa->leading_dot = len > 0 && comp[0] == '.';
+    nfa->ntokens = 0;
+
+    if (nfa->star == NULL || nfa->accept == NULL)
+        return false;
+
+    size_t i = 0;
+    while (i < len)
+    {
+        int t = nfa->ntokens;
+        unsigned char c = comp[i];
+
+        if (c == '*')
+        {
+            // Runs of stars are equivalent to a single star
+            if (t == 0 || !(nfa->star[(t-1) / 64] >> ((t-1) % 64) & 1))
+            {
+                set_bit(nfa->star, t);
+                for (int b = 1; b < 256; b++)
+                    set_bit(nfa->accept + b * nfa->words, t);
+                nfa->ntokens++;
+            }
+            i++;
+        }
+        else if (c == '?')
+        {
+            for (int b = 1; b < 256; b++)
+                set_bit(nfa->accept + b * nfa->words, t);
+            nfa->ntokens++;
+            i++;
+        }
+        else if (c == '[' && memchr(comp + i + 1, ']', len - i - 1) != NULL)
+        {
+            bool members[256] = {false};
+            bool negate = false;
+            size_t j = i + 1;
+
+            if (comp[j] == '!' || comp[j] == '^')
+            {
+                negate = true;
+                j++;
+            }
+
+            // A ']' directly after the opening bracket is a member
+            bool first = true;
+            while (j < len && (comp[j] != ']' || first))
+            {
+                unsigned char lo = comp[j];
+
+                if (j + 2 < len && comp[j+1] == '-' && comp[j+2] != ']')
+                {
+                    unsigned char hi = comp[j+2];
+                    for (int b = lo; b <= hi; b++)
+                        members[b] = true;
+                    j += 3;
+                }
+                else
+                {
+                    members[lo] = true;
+                    j++;
+                }
+                first = false;
+            }
+
+            for (int b = 1; b < 256; b++)
+                if (members[b] != negate)
+                    set_bit(nfa->accept + b * nfa->words, t);
+
+            nfa->ntokens++;
+            i = j + 1;
+        }
+        else
+        {
+            if (c == '\\' && i + 1 < len)
+                c = comp[++i];
+
+            set_bit(nfa->accept + c * nfa->words, t);
+            nfa->ntokens++;
+            i++;
+        }
+    }
+
+    return true;
+}
+
+static void nfa_free(glob_nfa_t * nfa)
+{
+    free(nfa->star);
+    free(nfa->accept);
+}
+
+/**
+ * Adds the states reachable by letting a `*` match nothing.
+ */
+static void nfa_closure(const glob_nfa_t * nfa, uint64_t * set)
+{
+    uint64_t carry = 0;
+
+    for (int w = 0; w < nfa->words; w++)
+    {
+        uint64_t skip = set[w] & nfa->star[w];
+        uint64_t out = (skip << 1) | carry;
+        carry = skip >> 63;
+        set[w] |= out;
+    }
+}
+
+static bool nfa_match(const glob_nfa_t * nfa, const char * name)
+{
+    if (name[0] == '.' && !nfa->leading_dot)
+        return false;
+
+    int words = nfa->words;
+    uint64_t set[words];
+    uint64_t next[words];
+
+    memset(set, 0, sizeof(set));
+    set[0] = 1;
+    nfa_closure(nfa, set);
+
+    for (const unsigned char * p = (const unsigned char *)name; *p; p++)
+    {
+        const uint64_t * accept = nfa->accept + *p * words;
+        uint64_t carry = 0;
+        bool alive = false;
+
+        for (int w = 0; w < words; w++)
+        {
+            uint64_t live = set[w] & accept[w];
+            uint64_t moved = live & ~nfa->star[w];
+
+            next[w] = (moved << 1) | carry | (live & nfa->star[w]);
+            carry = moved >> 63;
+            alive |= next[w] != 0;
+        }
+
+        if (!alive)
+            return false;
+
+        memcpy(set, next, sizeof(set));
+        nfa_closure(nfa, set);
+    }
+
+    return set[nfa->ntokens / 64] >> (nfa->ntokens % 64) & 1;
+}
+
+static bool comp_has_magic(const char * comp, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (comp[i] == '\\')
+            i++;
+        else if (comp[i] == '*' || comp[i] == '?')
+            return true;
+        else if (comp[i] == '[' && memchr(comp + i + 1, ']', len - i - 1))
+            return true;
+    }
+    return false;
+}
+
+static char * comp_unescape(const char * comp, size_t len)
+{
+    char * out = malloc(len + 1);
+    size_t o = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (comp[i] == '\\' && i + 1 < len)
+            i++;
+        out[o++] = comp[i];
+    }
+    out[o] = '\0';
+
+    return out;
+}
+
+static bool is_dir(const char * path, unsigned char type)
+{
+    struct stat st;
+
+    if (type == DT_DIR)
+        return true;
+    if (type != DT_UNKNOWN && type != DT_LNK)
+        return false;
+
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void dir_cache_free_entry(dir_cache_entry_t * entry)
+{
+    free(entry->listing.names);
+    free(entry->listing.types);
+    free(entry->blob);
+    free(entry);
+}
+
+static bool dir_scan(const char * dir, dir_cache_entry_t * entry)
+{
+    DIR * dp = opendir(dir);
+    if (dp == NULL)
+        return false;
+
+    size_t used = 0, cap = 4096;
+    char * blob = malloc(cap);
+    int count = 0;
+    struct dirent * de;
+
+    while ((de = readdir(dp)) != NULL)
+    {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+
+        size_t len = strlen(de->d_name);
+        while (used + len + 2 > cap)
+        {
+            cap *= 2;
+            blob = realloc(blob, cap);
+        }
+
+        blob[used] = de->d_type;
+        memcpy(blob + used + 1, de->d_name, len + 1);
+        used += len + 2;
+        count++;
+    }
+    closedir(dp);
+
+    char ** names = malloc((count ? count : 1) * sizeof(char *));
+    unsigned char * types = malloc(count ? count : 1);
+
+    for (size_t off = 0, i = 0; off < used; i++)
+    {
+        names[i] = blob + off + 1;
+        off += strlen(names[i]) + 2;
+    }
+
+    string_sort(names, count);
+
+    // The type byte sits right before each name in the blob
+    for (int i = 0; i < count; i++)
+        types[i] = (unsigned char)names[i][-1];
+
+    free(entry->listing.names);
+    free(entry->listing.types);
+    free(entry->blob);
+
+    entry->blob = blob;
+    entry->listing.names = names;
+    entry->listing.types = types;
+    entry->listing.count = count;
+
+    return true;
+}
+
+/**
+ * Appends prefix's descendants to out. Directories only unless files is set.
+ */
+static void walk_tree(const char * prefix, bool files, glob_list_t * out)
+{
+    const dir_listing_t * listing = dir_cache_lookup(prefix[0] ? prefix : ".");
+    if (listing == NULL)
+        return;
+
+    // Copy the names out; recursion may rescan and replace this listing
+    int count = listing->count;
+    char ** paths = malloc((count ? count : 1) * sizeof(char *));
+    bool * dirs = malloc(count ? count : 1);
+
+    for (int i = 0; i < count; i++)
+    {
+        const char * name = listing->names[i];
+        paths[i] = NULL;
+        dirs[i] = false;
+
+        if (name[0] == '.')
+            continue;
+
+        paths[i] = path_join(prefix, name, strlen(name));
+        dirs[i] = listing->types[i] == DT_DIR ||
+            (listing->types[i] == DT_UNKNOWN && is_dir(paths[i], DT_UNKNOWN));
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (paths[i] == NULL)
+            continue;
+
+        if (files || dirs[i])
+            list_push(out, strdup(paths[i]));
+        if (dirs[i])
+            walk_tree(paths[i], files, out);
+
+        free(paths[i]);
+    }
+
+    free(paths);
+    free(dirs);
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+void string_sort(char ** strs, size_t n)
+{
+    if (n <= RADIX_CUTOFF)
+    {
+        insertion_sort(strs, n, 0);
+        return;
+    }
+
+    char ** tmp = malloc(n * sizeof(char *));
+    radix_sort(strs, tmp, n, 0);
+    free(tmp);
+}
+
+const dir_listing_t * dir_cache_lookup(const char * dir)
+{
+    struct stat st;
+
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    size_t bucket = ((size_t)st.st_dev * 31 + (size_t)st.st_ino) % DIR_CACHE_BUCKETS;
+    dir_cache_entry_t * entry = dir_cache[bucket];
+
+    while (entry != NULL && (entry->dev != st.st_dev || entry->ino != st.st_ino))
+        entry = entry->next;
+
+    if (entry != NULL)
+    {
+        if (entry->mtime.tv_sec == st.st_mtim.tv_sec &&
+            entry->mtime.tv_nsec == st.st_mtim.tv_nsec)
+            return &entry->listing;
+    }
+    else
+    {
+        if (dir_cache_count >= DIR_CACHE_MAX)
+        {
+            dir_cache_clear();
+            bucket = ((size_t)st.st_dev * 31 + (size_t)st.st_ino) % DIR_CACHE_BUCKETS;
+        }
+
+        entry = calloc(1, sizeof(dir_cache_entry_t));
+        entry->dev = st.st_dev;
+        entry->ino = st.st_ino;
+        entry->next = dir_cache[bucket];
+        dir_cache[bucket] = entry;
+        dir_cache_count++;
+    }
+
+    if (!dir_scan(dir, entry))
+    {
+        entry->listing.count = 0;
+        return NULL;
+    }
+
+    entry->mtime = st.st_mtim;
+    return &entry->listing;
+}
+
+void dir_cache_clear()
+{
+    for (int b = 0; b < DIR_CACHE_BUCKETS; b++)
+    {
+        while (dir_cache[b] != NULL)
+        {
+            dir_cache_entry_t * entry = dir_cache[b];
+            dir_cache[b] = entry->next;
+            dir_cache_free_entry(entry);
+        }
+    }
+    dir_cache_count = 0;
+}
+
+bool glob_has_magic(const char * word)
+{
+    return comp_has_magic(word, strlen(word));
+}
+
+int glob_expand(const char * pattern, glob_list_t * out)
+{
+    glob_list_t cur = {0};
+    size_t plen = strlen(pattern);
+    bool trailing_slash = plen > 1 && pattern[plen-1] == '/';
+    bool unverified = false; // literal components after a magic one
+
+    list_push(&cur, strdup(pattern[0] == '/' ? "/" : ""));
+
+    const char * p = pattern;
+    while (*p != '\0' && cur.count > 0)
+    {
+        while (*p == '/')
+            p++;
+        if (*p == '\0')
+            break;
+
+        const char * end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char * rest = p + len;
+        while (*rest == '/')
+            rest++;
+        bool last = *rest == '\0';
+
+        glob_list_t next = {0};
+
+        if (len == 2 && !strncmp(p, "**", 2))
+        {
+            // Zero or more directories; as the last component, everything
+            for (int i = 0; i < cur.count; i++)
+            {
+                if (!last)
+                    list_push(&next, strdup(cur.paths[i]));
+                walk_tree(cur.paths[i], last && !trailing_slash, &next);
+            }
+        }
+        else if (!comp_has_magic(p, len))
+        {
+            char * lit = comp_unescape(p, len);
+            for (int i = 0; i < cur.count; i++)
+                list_push(&next, path_join(cur.paths[i], lit, strlen(lit)));
+            free(lit);
+            unverified = true;
+        }
+        else
+        {
+            glob_nfa_t nfa;
+            if (!nfa_compile(&nfa, p, len))
+            {
+                nfa_free(&nfa);
+                glob_list_free(&cur);
+                return 0;
+            }
+
+            for (int i = 0; i < cur.count; i++)
+            {
+                const char * prefix = cur.paths[i];
+                const dir_listing_t * listing = dir_cache_lookup(prefix[0] ? prefix : ".");
+                if (listing == NULL)
+                    continue;
+
+                for (int j = 0; j < listing->count; j++)
+                {
+                    const char * name = listing->names[j];
+                    if (!nfa_match(&nfa, name))
+                        continue;
+
+                    char * path = path_join(prefix, name, strlen(name));
+                    if ((!last || trailing_slash) && !is_dir(path, listing->types[j]))
+                    {
+                        free(path);
+                        continue;
+                    }
+                    list_push(&next, path);
+                }
+            }
+
+            nfa_free(&nfa);
+            unverified = false;
+        }
+
+        glob_list_free(&cur);
+        cur = next;
+        p = rest;
+    }
+
+    int added = 0;
+    int first = out->count;
+
+    for (int i = 0; i < cur.count; i++)
+    {
+        struct stat st;
+
+        if (unverified && lstat(cur.paths[i], &st) != 0)
+        {
+            free(cur.paths[i]);
+            continue;
+        }
+
+        if (trailing_slash)
+        {
+            char * path = path_join(cur.paths[i], "", 0);
+            free(cur.paths[i]);
+            cur.paths[i] = path;
+        }
+
+        list_push(out, cur.paths[i]);
+        added++;
+    }
+
+    free(cur.paths);
+    string_sort(out->paths + first, added);
+
+    return added;
+}
+
+void glob_list_free(glob_list_t * list)
+{
+    for (int i = 0; i < list->count; i++)
+        free(list->paths[i]);
+
+    free(list->paths);
+    list->paths = NULL;
+    list->count = 0;
+    list->cap = 0;
+}
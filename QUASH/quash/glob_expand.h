@@ -0,0 +1,69 @@
+/**
+ * @file glob_expand.h
+ *
+ * Pathname expansion (`*`, `?`, `[...]` and `**`) with a directory listing
+ * cache.
+ */
+
+#ifndef GLOB_EXPAND_H
+#define GLOB_EXPAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A growable list of malloc'd path strings produced by glob_expand().
+ */
+typedef struct glob_list_t {
+    char ** paths; ///< matched paths, each owned by the list
+    int count;     ///< number of paths in use
+    int cap;       ///< allocated slots in #glob_list_t.paths
+} glob_list_t;
+
+/**
+ * A cached, sorted listing of one directory. Owned by the cache; valid until
+ * the next call into this module.
+ */
+typedef struct dir_listing_t {
+    char ** names;         ///< entry names sorted bytewise, without . and ..
+    unsigned char * types; ///< dirent d_type of each entry (DT_UNKNOWN if absent)
+    int count;             ///< number of entries
+} dir_listing_t;
+
+/**
+ * Checks if a word contains unescaped glob characters.
+ */
+bool glob_has_magic(const char * word);
+
+/**
+ * Expands pattern against the filesystem and appends the sorted matches to
+ * out.
+ *
+ * @return the number of paths appended, 0 if nothing matched
+ */
+int glob_expand(const char * pattern, glob_list_t * out);
+
+/**
+ * Frees every path held by list and resets it to empty.
+ */
+void glob_list_free(glob_list_t * list);
+
+/**
+ * Returns the listing of dir, rescanning it only if its (dev, ino, mtime)
+ * changed since it was cached.
+ *
+ * @return the listing or NULL if dir cannot be read
+ */
+const dir_listing_t * dir_cache_lookup(const char * dir);
+
+/**
+ * Drops every cached directory listing.
+ */
+void dir_cache_clear();
+
+/**
+ * Sorts an array of strings bytewise with an MSD radix sort.
+ */
+void string_sort(char ** strs, size_t n);
+
+#endif // GLOB_EXPAND_H
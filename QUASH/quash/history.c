@@ -0,0 +1,601 @@
+/**
+ * @file history.c
+ *
+ * The history file is a 64 byte header followed by newline terminated
+ * entries. It is mapped MAP_SHARED and grown by doubling. The in-memory index
+ * holds the offset of every entry and, for each trigram, the ascending list of
+ * entries containing it. Startup only maps the file; a background thread
+ * indexes the existing entries in chunks, and the newest entries that have
+ * not been indexed yet are searched by scanning.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#define _GNU_SOURCE // memmem() and memrchr()
+#include "history.h"
+#include "redirect.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define HISTORY_MAGIC "QUASHHS1"
+/// Smallest mapping made for a history file
+#define HISTORY_MIN_MAP (64 * 1024)
+/// Entries indexed by the builder each time it takes the lock
+#define HISTORY_CHUNK (4096)
+
+/**
+ * Layout of the first 64 bytes of the history file.
+ */
+typedef struct history_header_t {
+    char magic[8];
+    uint64_t used;        ///< bytes of entries after the header
+    uint64_t reserved[6];
+} history_header_t;
+
+/**
+ * Entries containing one trigram, in ascending order.
+ */
+typedef struct posting_t {
+    uint32_t key;         ///< trigram + 1, 0 marks an empty slot
+    uint32_t count;
+    uint32_t cap;
+    uint32_t * ids;
+} posting_t;
+
+static int histFd = -1;
+static char * map = NULL;
+static size_t mapSize = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t builder;
+static bool builderStarted = false;
+static bool builderRunning = false;
+
+static uint64_t * offsets = NULL;  ///< start of each indexed entry
+static uint32_t numEntries = 0;
+static uint32_t offsetsCap = 0;
+static uint64_t indexedUpto = 0;   ///< bytes of entries already indexed
+
+static posting_t * table = NULL;
+static uint32_t tableCap = 0;      ///< power of two
+static uint32_t tableUsed = 0;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static history_header_t * header()
+{
+    return (history_header_t *)map;
+}
+
+static char * data()
+{
+    return map + sizeof(history_header_t);
+}
+
+static uint32_t trigram(const char * s)
+{
+    return ((uint32_t)(unsigned char)s[0] << 16 |
+            (uint32_t)(unsigned char)s[1] << 8 |
+            (uint32_t)(unsigned char)s[2]) + 1;
+}
+
+static uint32_t hash_key(uint32_t key)
+{
+    key *= 0x9E3779B1u;
+    return key ^ (key >> 15);
+}
+
+static posting_t * table_find(uint32_t key, bool insert)
+{
+    if (insert && (tableUsed + 1) * 2 > tableCap)
+    {
+        posting_t * old = table;
+        uint32_t oldCap = tableCap;
+
+        tableCap = tableCap ? tableCap * 2 : 4096;
+        table = calloc(tableCap, sizeof(posting_t));
+
+        for (uint32_t i = 0; i < oldCap; i++)
+        {
+            if (old[i].key == 0)
+                continue;
+
+            uint32_t slot = hash_key(old[i].key) & (tableCap - 1);
+            while (table[slot].key != 0)
+                slot = (slot + 1) & (tableCap - 1);
+            table[slot] = old[i];
+        }
+        free(old);
+    }
+
+    if (tableCap == 0)
+        return NULL;
+
+    uint32_t slot = hash_key(key) & (tableCap - 1);
+    while (table[slot].key != 0)
+    {
+        if (table[slot].key == key)
+            return &table[slot];
+        slot = (slot + 1) & (tableCap - 1);
+    }
+
+    if (!insert)
+        return NULL;
+
+    table[slot].key = key;
+    tableUsed++;
+    return &table[slot];
+}
+
+static void posting_add(posting_t * p, uint32_t id)
+{
+    // Entries are indexed in order, so a repeat can only be the last id
+    if (p->count > 0 && p->ids[p->count-1] == id)
+        return;
+
+    if (p->count == p->cap)
+    {
+        p->cap = p->cap ? p->cap * 2 : 4;
+        p->ids = realloc(p->ids, p->cap * sizeof(uint32_t));
+    }
+    p->ids[p->count++] = id;
+}
+
+static bool posting_has(const posting_t * p, uint32_t id)
+{
+    uint32_t lo = 0, hi = p->count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (p->ids[mid] < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < p->count && p->ids[lo] == id;
+}
+
+/**
+ * Indexes entries from indexedUpto up to limit bytes, at most max of them.
+ * Must be called with the lock held.
+ */
+static void index_entries(uint64_t limit, int max)
+{
+    const char * base = data();
+
+    while (indexedUpto < limit && max-- > 0)
+    {
+        const char * line = base + indexedUpto;
+        const char * nl = memchr(line, '\n', limit - indexedUpto);
+        size_t len = nl ? (size_t)(nl - line) : limit - indexedUpto;
+
+        if (numEntries == offsetsCap)
+        {
+            offsetsCap = offsetsCap ? offsetsCap * 2 : 1024;
+            offsets = realloc(offsets, offsetsCap * sizeof(uint64_t));
+        }
+        offsets[numEntries] = indexedUpto;
+
+        for (size_t i = 0; i + 3 <= len; i++)
+            posting_add(table_find(trigram(line + i), true), numEntries);
+
+        numEntries++;
+        indexedUpto += len + 1;
+    }
+}
+
+/**
+ * Makes sure the mapping covers at least size bytes of file. Must be called
+ * with the lock held.
+ */
+static bool ensure_mapped(size_t size)
+{
+    if (size <= mapSize)
+        return true;
+
+    size_t newSize = mapSize ? mapSize : HISTORY_MIN_MAP;
+    while (newSize < size)
+        newSize *= 2;
+
+    struct stat st;
+    if (fstat(histFd, &st) != 0)
+        return false;
+    if ((size_t)st.st_size < newSize && ftruncate(histFd, newSize) != 0)
+        return false;
+    if ((size_t)st.st_size > newSize)
+        newSize = st.st_size;
+
+    char * newMap = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, histFd, 0);
+    if (newMap == MAP_FAILED)
+        return false;
+
+    if (map != NULL)
+        munmap(map, mapSize);
+    map = newMap;
+    mapSize = newSize;
+    return true;
+}
+
+/**
+ * Returns how many bytes of entries the file holds, first remapping it if
+ * another shell has grown it past the mapping. Must be called with the lock
+ * held, and before taking any pointer into the mapping.
+ */
+static uint64_t mapped_used()
+{
+    uint64_t used = header()->used;
+
+    if (!ensure_mapped(sizeof(history_header_t) + used))
+        used = mapSize - sizeof(history_header_t);
+    return used;
+}
+
+static void * build_index(void * arg)
+{
+    bool done = false;
+
+    while (!done)
+    {
+        pthread_mutex_lock(&lock);
+        uint64_t used = mapped_used();
+        index_entries(used, HISTORY_CHUNK);
+        done = indexedUpto >= used;
+        if (done)
+            builderRunning = false;
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+/**
+ * Finds the last entry starting before the offset before that contains
+ * query by scanning the entries in [from, to). Must be called with the lock
+ * held.
+ */
+static long scan_back(const char * query, uint64_t from, uint64_t to, uint64_t before)
+{
+    const char * base = data();
+    size_t qlen = strlen(query);
+    long found = -1;
+
+    if (before < to)
+        to = before;
+
+    uint64_t off = from;
+    while (off < to)
+    {
+        const char * line = base + off;
+        const char * nl = memchr(line, '\n', to - off);
+        size_t len = nl ? (size_t)(nl - line) : to - off;
+
+        if (memmem(line, len, query, qlen) != NULL)
+            found = off;
+        off += len + 1;
+    }
+    return found;
+}
+
+/**
+ * Finds the newest indexed entry with an id below limit containing query.
+ * Must be called with the lock held.
+ */
+static long search_index(const char * query, uint32_t limit)
+{
+    size_t qlen = strlen(query);
+    int ngrams = (int)qlen - 2;
+    posting_t * grams[ngrams];
+    posting_t * shortest = NULL;
+
+    for (int i = 0; i < ngrams; i++)
+    {
+        grams[i] = table_find(trigram(query + i), false);
+        if (grams[i] == NULL)
+            return -1;
+        if (shortest == NULL || grams[i]->count < shortest->count)
+            shortest = grams[i];
+    }
+
+    // Walk the rarest trigram's entries newest first
+    uint32_t lo = 0, hi = shortest->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (shortest->ids[mid] < limit)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (uint32_t k = lo; k-- > 0; )
+    {
+        uint32_t id = shortest->ids[k];
+        bool all = true;
+
+        for (int i = 0; i < ngrams && all; i++)
+            if (grams[i] != shortest)
+                all = posting_has(grams[i], id);
+
+        if (!all)
+            continue;
+
+        const char * line = data() + offsets[id];
+        uint64_t end = id + 1 < numEntries ? offsets[id+1] - 1 : indexedUpto - 1;
+        if (memmem(line, end - offsets[id], query, qlen) != NULL)
+            return offsets[id];
+    }
+    return -1;
+}
+
+/**
+ * Copies the entry starting at off, which ends by used, into a new string.
+ * Must be called with the lock held.
+ */
+static char * copy_entry(uint64_t off, uint64_t used)
+{
+    const char * start = data() + off;
+    const char * nl = memchr(start, '\n', used - off);
+    size_t len = nl ? (size_t)(nl - start) : used - off;
+    char * line = malloc(len + 1);
+
+    memcpy(line, start, len);
+    line[len] = '\0';
+    return line;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+bool history_open(const char * path)
+{
+    histFd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (histFd < 0)
+        return false;
+
+    // Keep clear of the descriptors scripts can take with exec N> file
+    int high = fcntl(histFd, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+    if (high >= 0)
+    {
+        close(histFd);
+        histFd = high;
+    }
+
+    struct stat st;
+    fstat(histFd, &st);
+
+    flock(histFd, LOCK_EX);
+    if (!ensure_mapped(st.st_size > HISTORY_MIN_MAP ? st.st_size : HISTORY_MIN_MAP))
+    {
+        flock(histFd, LOCK_UN);
+        close(histFd);
+        histFd = -1;
+        return false;
+    }
+
+    if (st.st_size == 0 || header()->magic[0] == '\0')
+    {
+        memcpy(header()->magic, HISTORY_MAGIC, sizeof(header()->magic));
+        header()->used = 0;
+    }
+    flock(histFd, LOCK_UN);
+
+    if (memcmp(header()->magic, HISTORY_MAGIC, sizeof(header()->magic)) != 0)
+    {
+        fprintf(stderr, "%s is not a quash history file\n", path);
+        munmap(map, mapSize);
+        map = NULL;
+        close(histFd);
+        histFd = -1;
+        return false;
+    }
+
+    builderRunning = true;
+    builderStarted = pthread_create(&builder, NULL, build_index, NULL) == 0;
+    if (!builderStarted)
+        build_index(NULL);
+
+    return true;
+}
+
+void history_append(const char * line)
+{
+    if (histFd < 0 || line[0] == '\0')
+        return;
+
+    size_t len = strlen(line);
+
+    pthread_mutex_lock(&lock);
+    flock(histFd, LOCK_EX);
+
+    // Another shell may have grown the file since it was mapped
+    uint64_t used = header()->used;
+    if (ensure_mapped(sizeof(history_header_t) + used + len + 1))
+    {
+        memcpy(data() + used, line, len);
+        data()[used + len] = '\n';
+        header()->used = used + len + 1;
+
+        if (!builderRunning)
+            index_entries(header()->used, INT32_MAX);
+    }
+
+    flock(histFd, LOCK_UN);
+    pthread_mutex_unlock(&lock);
+}
+
+long history_search(const char * query, long before, char ** line)
+{
+    if (histFd < 0 || query[0] == '\0')
+        return -1;
+
+    pthread_mutex_lock(&lock);
+
+    uint64_t used = mapped_used();
+    uint64_t limit = before < 0 ? used : (uint64_t)before;
+    long found = -1;
+
+    // The newest entries may not be indexed yet
+    if (limit > indexedUpto)
+        found = scan_back(query, indexedUpto, used, limit);
+
+    if (found < 0)
+    {
+        if (strlen(query) < 3)
+        {
+            found = scan_back(query, 0, indexedUpto, limit);
+        }
+        else
+        {
+            uint32_t lo = 0, hi = numEntries;
+            while (lo < hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (offsets[mid] < limit)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            found = search_index(query, lo);
+        }
+    }
+
+    if (found >= 0)
+        *line = copy_entry(found, used);
+
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+long history_prev(long before, char ** line)
+{
+    if (histFd < 0)
+        return -1;
+
+    pthread_mutex_lock(&lock);
+
+    uint64_t used = mapped_used();
+    uint64_t end = before < 0 || (uint64_t)before > used ? used : (uint64_t)before;
+    long found = -1;
+
+    if (end > 0)
+    {
+        const char * nl = end > 1 ? memrchr(data(), '\n', end - 1) : NULL;
+        found = nl ? (long)(nl - data()) + 1 : 0;
+        *line = copy_entry(found, used);
+    }
+
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+long history_next(long after, char ** line)
+{
+    if (histFd < 0 || after < 0)
+        return -1;
+
+    pthread_mutex_lock(&lock);
+
+    uint64_t used = mapped_used();
+    const char * nl = (uint64_t)after < used ? memchr(data() + after, '\n', used - after) : NULL;
+    long found = -1;
+
+    if (nl != NULL && (uint64_t)(nl - data()) + 1 < used)
+    {
+        found = (long)(nl - data()) + 1;
+        *line = copy_entry(found, used);
+    }
+
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+void history_print(FILE * out, int count)
+{
+    if (histFd < 0)
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    uint64_t used = mapped_used();
+    const char * base = data();
+    uint64_t start = used;
+    int n = 0;
+
+    // Walk back over the last count entries
+    while (start > 0 && (count < 0 || n < count))
+    {
+        const char * nl = start > 1 ? memrchr(base, '\n', start - 1) : NULL;
+        start = nl ? (uint64_t)(nl - base) + 1 : 0;
+        n++;
+    }
+
+    // Number the entries from the index, counting lines only past its end
+    uint64_t number = 1;
+    if (start >= indexedUpto)
+    {
+        number += numEntries;
+        for (const char * p = base + indexedUpto; p < base + start; p++)
+            number += *p == '\n';
+    }
+    else
+    {
+        uint32_t lo = 0, hi = numEntries;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (offsets[mid] < start)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        number += lo;
+    }
+
+    while (start < used)
+    {
+        const char * nl = memchr(base + start, '\n', used - start);
+        size_t len = nl ? (size_t)(nl - (base + start)) : used - start;
+
+        fprintf(out, "%5lu  %.*s\n", (unsigned long)number++, (int)len, base + start);
+        start += len + 1;
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+void history_close()
+{
+    if (histFd < 0)
+        return;
+
+    if (builderStarted)
+        pthread_join(builder, NULL);
+    builderStarted = false;
+
+    for (uint32_t i = 0; i < tableCap; i++)
+        free(table[i].ids);
+    free(table);
+    free(offsets);
+    table = NULL;
+    offsets = NULL;
+    tableCap = tableUsed = numEntries = offsetsCap = 0;
+    indexedUpto = 0;
+
+    munmap(map, mapSize);
+    map = NULL;
+    mapSize = 0;
+    close(histFd);
+    histFd = -1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file history.h
+ *
+ * Persistent command history kept in an mmap'd log file, with a trigram
+ * index for substring search that is built on a background thread.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Search from the most recent entry backwards.
+ */
+#define HISTORY_END (-1L)
+
+/**
+ * Maps the history file at path, creating it if needed, and starts indexing
+ * it in the background.
+ *
+ * @return True if history is available and false otherwise
+ */
+bool history_open(const char * path);
+
+/**
+ * Appends line to the history file and the index.
+ */
+void history_append(const char * line);
+
+/**
+ * Finds the most recent entry containing query that starts before the entry
+ * at offset before.
+ *
+ * @param query - substring to look for
+ * @param before - offset returned by a previous search or #HISTORY_END
+ * @param line - set to a copy of the matched entry; free it with free()
+ * @return the offset of the matched entry or -1 if there is none
+ */
+long history_search(const char * query, long before, char ** line);
+
+/**
+ * Finds the entry just before the entry at offset before.
+ *
+ * @param before - offset of an entry or #HISTORY_END for the newest entry
+ * @param line - set to a copy of the entry; free it with free()
+ * @return the offset of the entry or -1 if before is the oldest
+ */
+long history_prev(long before, char ** line);
+
+/**
+ * Finds the entry just after the entry at offset after.
+ *
+ * @param after - offset of an entry
+ * @param line - set to a copy of the entry; free it with free()
+ * @return the offset of the entry or -1 if after is the newest
+ */
+long history_next(long after, char ** line);
+
+/**
+ * Prints the last count entries, or all of them if count is negative.
+ */
+void history_print(FILE * out, int count);
+
+/**
+ * Waits for the index builder and unmaps the history file.
+ */
+void history_close();
+
+#endif // HISTORY_H
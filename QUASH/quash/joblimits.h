@@ -0,0 +1,76 @@
+/**
+ * @file joblimits.h
+ *
+ * Resource limits applied to commands Quash starts and optional cgroup v2
+ * placement of background jobs.
+ */
+
+#ifndef JOBLIMITS_H
+#define JOBLIMITS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Sets the limit selected by a ulimit flag: 't' CPU seconds, 'v' address
+ * space in kilobytes or 'n' open files.
+ *
+ * @param flag - the ulimit flag
+ * @param value - a number or "unlimited"
+ * @return True if the limit was recorded and false otherwise
+ */
+bool limits_set(char flag, const char * value);
+
+/**
+ * Prints the limits in ulimit -a style.
+ */
+void limits_print(FILE * out);
+
+/**
+ * Applies the recorded limits to the calling process. Called in a child
+ * after fork and before exec.
+ */
+void limits_apply();
+
+/**
+ * Enables cgroup placement for background jobs or changes its settings.
+ *
+ * @param cpuMax - value for cpu.max, e.g. "50000 100000", or NULL to keep
+ * @param memoryMax - value for memory.max, e.g. "512M", or NULL to keep
+ * @return True if the cgroup root is usable and false otherwise
+ */
+bool cgroup_configure(const char * cpuMax, const char * memoryMax);
+
+/**
+ * Stops placing new background jobs in cgroups.
+ */
+void cgroup_disable();
+
+/**
+ * Prints the cgroup settings.
+ */
+void cgroup_print(FILE * out);
+
+/**
+ * Creates the cgroup for a new background job.
+ *
+ * @param path - receives the cgroup directory
+ * @param len - size of path
+ * @return True if a cgroup was created and false if placement is off or
+ *         failed
+ */
+bool cgroup_create(char * path, size_t len);
+
+/**
+ * Moves the calling process into the cgroup at path. Called in a child after
+ * fork and before exec.
+ */
+void cgroup_join(const char * path);
+
+/**
+ * Removes the cgroup at path. Safe to call from a signal handler.
+ */
+void cgroup_remove(const char * path);
+
+#endif // JOBLIMITS_H
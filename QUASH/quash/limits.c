@@ -0,0 +1,224 @@
+/**
+ * @file limits.c
+ *
+ * The limits are only recorded in the shell and applied with setrlimit() in
+ * each child, so Quash itself is never limited. Background job cgroups are
+ * made under $QUASH_CGROUP (default /sys/fs/cgroup/quash), which needs the
+ * cpu and memory controllers delegated to it.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "joblimits.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define CGROUP_DEFAULT_ROOT "/sys/fs/cgroup/quash"
+
+/**
+ * One ulimit-style limit.
+ */
+typedef struct limit_t {
+    char flag;
+    int resource;
+    rlim_t unit;        ///< bytes per unit of the user's value
+    const char * name;
+    bool set;
+    rlim_t value;
+} limit_t;
+
+static limit_t limits[] = {
+    { 't', RLIMIT_CPU,    1,    "cpu time (seconds)",            false, 0 },
+    { 'v', RLIMIT_AS,     1024, "virtual memory (kbytes)",       false, 0 },
+    { 'n', RLIMIT_NOFILE, 1,    "open files",                    false, 0 },
+};
+
+#define NUM_LIMITS (sizeof(limits) / sizeof(limits[0]))
+
+static bool cgroupOn = false;
+static char cgroupRoot[256];
+static char cpuMax[64] = "max 100000";
+static char memoryMax[64] = "max";
+static unsigned cgroupCount = 0;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static bool write_file(const char * dir, const char * file, const char * value)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return false;
+
+    ssize_t len = strlen(value);
+    bool ok = write(fd, value, len) == len;
+    close(fd);
+
+    return ok;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+bool limits_set(char flag, const char * value)
+{
+    for (size_t i = 0; i < NUM_LIMITS; i++)
+    {
+        if (limits[i].flag != flag)
+            continue;
+
+        if (!strcmp(value, "unlimited"))
+        {
+            limits[i].set = true;
+            limits[i].value = RLIM_INFINITY;
+            return true;
+        }
+
+        char * end;
+        unsigned long long n = strtoull(value, &end, 10);
+        if (*end != '\0' || end == value)
+            return false;
+
+        limits[i].set = true;
+        limits[i].value = (rlim_t)n * limits[i].unit;
+        return true;
+    }
+    return false;
+}
+
+void limits_print(FILE * out)
+{
+    for (size_t i = 0; i < NUM_LIMITS; i++)
+    {
+        fprintf(out, "%-32s(-%c) ", limits[i].name, limits[i].flag);
+
+        if (!limits[i].set || limits[i].value == RLIM_INFINITY)
+            fprintf(out, "unlimited\n");
+        else
+            fprintf(out, "%llu\n", (unsigned long long)(limits[i].value / limits[i].unit));
+    }
+}
+
+void limits_apply()
+{
+    for (size_t i = 0; i < NUM_LIMITS; i++)
+    {
+        if (!limits[i].set)
+            continue;
+
+        struct rlimit rl;
+        getrlimit(limits[i].resource, &rl);
+
+        // An unprivileged process cannot raise its hard limit
+        rl.rlim_cur = limits[i].value;
+        if (rl.rlim_max != RLIM_INFINITY && rl.rlim_cur > rl.rlim_max)
+            rl.rlim_cur = rl.rlim_max;
+        if (limits[i].value != RLIM_INFINITY)
+            rl.rlim_max = rl.rlim_cur;
+
+        if (setrlimit(limits[i].resource, &rl) != 0)
+            fprintf(stderr, "Cannot set %s limit. ERROR# %d\n", limits[i].name, errno);
+    }
+}
+
+bool cgroup_configure(const char * cpu, const char * memory)
+{
+    const char * root = getenv("QUASH_CGROUP");
+    snprintf(cgroupRoot, sizeof(cgroupRoot), "%s", root != NULL ? root : CGROUP_DEFAULT_ROOT);
+
+    if (mkdir(cgroupRoot, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Cannot create cgroup %s. ERROR# %d\n", cgroupRoot, errno);
+        return false;
+    }
+
+    // Let the job cgroups below the root use the cpu and memory controllers
+    if (!write_file(cgroupRoot, "cgroup.subtree_control", "+cpu +memory"))
+    {
+        fprintf(stderr, "Cannot enable cpu and memory controllers in %s. ERROR# %d\n",
+                cgroupRoot, errno);
+        return false;
+    }
+
+    if (cpu != NULL)
+        snprintf(cpuMax, sizeof(cpuMax), "%s", cpu);
+    if (memory != NULL)
+        snprintf(memoryMax, sizeof(memoryMax), "%s", memory);
+
+    cgroupOn = true;
+    return true;
+}
+
+void cgroup_disable()
+{
+    cgroupOn = false;
+}
+
+void cgroup_print(FILE * out)
+{
+    if (!cgroupOn)
+    {
+        fprintf(out, "cgroup placement is off\n");
+        return;
+    }
+
+    fprintf(out, "root       %s\n", cgroupRoot);
+    fprintf(out, "cpu.max    %s\n", cpuMax);
+    fprintf(out, "memory.max %s\n", memoryMax);
+}
+
+bool cgroup_create(char * path, size_t len)
+{
+    if (!cgroupOn)
+        return false;
+
+    snprintf(path, len, "%s/job%d-%u", cgroupRoot, (int)getpid(), cgroupCount++);
+
+    if (mkdir(path, 0755) != 0)
+    {
+        fprintf(stderr, "Cannot create cgroup %s. ERROR# %d\n", path, errno);
+        path[0] = '\0';
+        return false;
+    }
+
+    if (!write_file(path, "cpu.max", cpuMax) || !write_file(path, "memory.max", memoryMax))
+    {
+        fprintf(stderr, "Cannot configure cgroup %s. ERROR# %d\n", path, errno);
+        rmdir(path);
+        path[0] = '\0';
+        return false;
+    }
+
+    return true;
+}
+
+void cgroup_join(const char * path)
+{
+    char pid[32];
+
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    if (!write_file(path, "cgroup.procs", pid))
+        fprintf(stderr, "Cannot join cgroup %s. ERROR# %d\n", path, errno);
+}
+
+void cgroup_remove(const char * path)
+{
+    if (path != NULL && path[0] != '\0')
+        rmdir(path);
+}
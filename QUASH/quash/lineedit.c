@@ -0,0 +1,491 @@
+/**
+ * @file lineedit.c
+ *
+ * The terminal is put in raw mode only while a line is being read. Every
+ * redraw is built in memory and written with a single write().
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "lineedit.h"
+#include "complete.h"
+#include "history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define KEY_CTRL(c) ((c) & 0x1f)
+#define KEY_BACKSPACE (127)
+#define KEY_ESC (27)
+/// Most candidates listed when Tab is pressed twice
+#define MAX_LISTED (100)
+
+/**
+ * Output collected for one redraw.
+ */
+typedef struct out_buf_t {
+    char data[8192];
+    size_t len;
+} out_buf_t;
+
+/**
+ * The line being edited.
+ */
+typedef struct line_t {
+    char * buf;
+    size_t size;   ///< capacity of buf including the terminator
+    size_t len;
+    size_t pos;    ///< cursor position
+    const char * prompt;
+} line_t;
+
+static struct termios savedTermios;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void out_add(out_buf_t * out, const char * s, size_t len)
+{
+    if (out->len + len > sizeof(out->data))
+    {
+        write(STDOUT_FILENO, out->data, out->len);
+        out->len = 0;
+    }
+
+    if (len > sizeof(out->data))
+    {
+        write(STDOUT_FILENO, s, len);
+        return;
+    }
+
+    memcpy(out->data + out->len, s, len);
+    out->len += len;
+}
+
+static void out_flush(out_buf_t * out)
+{
+    if (out->len > 0)
+        write(STDOUT_FILENO, out->data, out->len);
+    out->len = 0;
+}
+
+static bool raw_enable()
+{
+    struct termios raw;
+
+    if (tcgetattr(STDIN_FILENO, &savedTermios) != 0)
+        return false;
+
+    raw = savedTermios;
+    raw.c_iflag &= ~(ICRNL | IXON | BRKINT | INPCK | ISTRIP);
+    raw.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+
+    return tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+}
+
+static void raw_disable()
+{
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTermios);
+}
+
+/**
+ * Reads one byte, retrying reads interrupted by SIGCHLD.
+ *
+ * @return the byte or -1 at end of input
+ */
+static int read_key(bool * interrupted)
+{
+    unsigned char c;
+
+    for (;;)
+    {
+        ssize_t n = read(STDIN_FILENO, &c, 1);
+        if (n == 1)
+            return c;
+        if (n < 0 && errno == EINTR)
+        {
+            *interrupted = true;
+            continue;
+        }
+        return -1;
+    }
+}
+
+static void refresh(const line_t * l)
+{
+    out_buf_t out = {.len = 0};
+    char seq[32];
+
+    out_add(&out, "\r", 1);
+    out_add(&out, l->prompt, strlen(l->prompt));
+    out_add(&out, l->buf, l->len);
+    out_add(&out, "\x1b[K\r", 4);
+
+    size_t col = strlen(l->prompt) + l->pos;
+    if (col > 0)
+    {
+        int n = snprintf(seq, sizeof(seq), "\x1b[%zuC", col);
+        out_add(&out, seq, n);
+    }
+    out_flush(&out);
+}
+
+static void line_set(line_t * l, const char * text)
+{
+    size_t len = strlen(text);
+
+    if (len > l->size - 2)
+        len = l->size - 2;
+
+    memcpy(l->buf, text, len);
+    l->len = l->pos = len;
+    l->buf[len] = '\0';
+}
+
+static void line_insert(line_t * l, const char * text, size_t len)
+{
+    if (l->len + len > l->size - 2)
+        len = l->size - 2 - l->len;
+
+    memmove(l->buf + l->pos + len, l->buf + l->pos, l->len - l->pos);
+    memcpy(l->buf + l->pos, text, len);
+    l->len += len;
+    l->pos += len;
+    l->buf[l->len] = '\0';
+}
+
+static void line_delete(line_t * l, size_t at, size_t len)
+{
+    memmove(l->buf + at, l->buf + at + len, l->len - at - len);
+    l->len -= len;
+    l->buf[l->len] = '\0';
+}
+
+/**
+ * Completes the word before the cursor, listing the candidates if list is
+ * set and the word cannot be extended.
+ */
+static void tab_complete(line_t * l, bool list)
+{
+    size_t start = l->pos;
+    while (start > 0 && l->buf[start-1] != ' ')
+        start--;
+
+    // A word is a command name at the start of the line or after a pipe
+    size_t before = start;
+    while (before > 0 && l->buf[before-1] == ' ')
+        before--;
+    bool command = before == 0 || l->buf[before-1] == '|';
+
+    char word[1024];
+    char ext[1024];
+    size_t wlen = l->pos - start < sizeof(word) - 1 ? l->pos - start : sizeof(word) - 1;
+    memcpy(word, l->buf + start, wlen);
+    word[wlen] = '\0';
+
+    glob_list_t matches = {0};
+    int found = complete_word(word, command, ext, sizeof(ext), list ? &matches : NULL, MAX_LISTED);
+
+    if (ext[0] != '\0')
+    {
+        line_insert(l, ext, strlen(ext));
+    }
+    else if (list && found > 1)
+    {
+        out_buf_t out = {.len = 0};
+
+        out_add(&out, "\r\n", 2);
+        for (int i = 0; i < matches.count; i++)
+        {
+            out_add(&out, matches.paths[i], strlen(matches.paths[i]));
+            out_add(&out, "  ", 2);
+        }
+        if (found >= MAX_LISTED)
+            out_add(&out, "...", 3);
+        out_add(&out, "\r\n", 2);
+        out_flush(&out);
+    }
+    else if (found == 0)
+    {
+        write(STDOUT_FILENO, "\a", 1);
+    }
+
+    glob_list_free(&matches);
+}
+
+/**
+ * Runs an incremental reverse search. The accepted entry replaces the line.
+ *
+ * @return True if Enter accepted the entry and false otherwise
+ */
+static bool reverse_search(line_t * l)
+{
+    char query[256] = "";
+    size_t qlen = 0;
+    long pos = HISTORY_END;
+    char * match = NULL;
+    bool interrupted = false;
+    bool accept = false;
+
+    for (;;)
+    {
+        out_buf_t out = {.len = 0};
+        char head[320];
+        int n = snprintf(head, sizeof(head), "\r(reverse-i-search)`%s': ", query);
+
+        out_add(&out, head, n);
+        if (match != NULL)
+            out_add(&out, match, strlen(match));
+        out_add(&out, "\x1b[K", 3);
+        out_flush(&out);
+
+        int c = read_key(&interrupted);
+
+        if (c == KEY_CTRL('R'))
+        {
+            char * older = NULL;
+            long found = history_search(query, pos, &older);
+            if (found >= 0)
+            {
+                free(match);
+                match = older;
+                pos = found;
+            }
+        }
+        else if ((c == KEY_BACKSPACE || c == KEY_CTRL('H')) && qlen > 0)
+        {
+            query[--qlen] = '\0';
+            free(match);
+            match = NULL;
+            pos = history_search(query, HISTORY_END, &match);
+        }
+        else if (c >= ' ' && c < KEY_BACKSPACE && qlen + 1 < sizeof(query))
+        {
+            char * found = NULL;
+            query[qlen++] = c;
+            query[qlen] = '\0';
+
+            long at = history_search(query, HISTORY_END, &found);
+            if (at >= 0)
+            {
+                free(match);
+                match = found;
+                pos = at;
+            }
+        }
+        else if (c == KEY_CTRL('G') || c == KEY_CTRL('C') || c < 0)
+        {
+            break;
+        }
+        else
+        {
+            if (match != NULL)
+                line_set(l, match);
+            accept = c == '\r' || c == '\n';
+            break;
+        }
+    }
+
+    free(match);
+    return accept;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+int lineedit_read(const char * prompt, char * buf, size_t size)
+{
+    line_t l = {.buf = buf, .size = size, .len = 0, .pos = 0, .prompt = prompt};
+    long histPos = HISTORY_END;
+    char * edited = NULL; // the line being typed while walking the history
+    bool lastTab = false;
+    int result = 0;
+
+    buf[0] = '\0';
+    fflush(stdout);
+
+    if (size < 3 || !raw_enable())
+    {
+        fputs(prompt, stdout);
+        fflush(stdout);
+        return fgets(buf, size, stdin) != NULL ? (int)strlen(buf) : -1;
+    }
+
+    refresh(&l);
+
+    for (;;)
+    {
+        bool interrupted = false;
+        int c = read_key(&interrupted);
+        bool tab = false;
+
+        if (c < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        switch (c)
+        {
+        case '\r':
+        case '\n':
+            result = 1;
+            break;
+        case KEY_CTRL('D'):
+            if (l.len == 0)
+                result = -1;
+            else if (l.pos < l.len)
+                line_delete(&l, l.pos, 1);
+            break;
+        case KEY_CTRL('C'):
+            l.len = l.pos = 0;
+            buf[0] = '\0';
+            write(STDOUT_FILENO, "^C", 2);
+            result = 1;
+            break;
+        case KEY_BACKSPACE:
+        case KEY_CTRL('H'):
+            if (l.pos > 0)
+            {
+                l.pos--;
+                line_delete(&l, l.pos, 1);
+            }
+            break;
+        case KEY_CTRL('A'):
+            l.pos = 0;
+            break;
+        case KEY_CTRL('E'):
+            l.pos = l.len;
+            break;
+        case KEY_CTRL('B'):
+            if (l.pos > 0)
+                l.pos--;
+            break;
+        case KEY_CTRL('F'):
+            if (l.pos < l.len)
+                l.pos++;
+            break;
+        case KEY_CTRL('U'):
+            line_delete(&l, 0, l.pos);
+            l.pos = 0;
+            break;
+        case KEY_CTRL('K'):
+            line_delete(&l, l.pos, l.len - l.pos);
+            break;
+        case KEY_CTRL('L'):
+            write(STDOUT_FILENO, "\x1b[H\x1b[2J", 7);
+            break;
+        case '\t':
+            tab_complete(&l, lastTab);
+            tab = true;
+            break;
+        case KEY_CTRL('R'):
+            if (reverse_search(&l))
+            {
+                refresh(&l);
+                result = 1;
+            }
+            break;
+        case KEY_CTRL('P'):
+        case KEY_CTRL('N'):
+        case KEY_ESC:
+        {
+            int key = c;
+            if (c == KEY_ESC)
+            {
+                int a = read_key(&interrupted);
+                int b = read_key(&interrupted);
+
+                if (a == '[' && b >= '0' && b <= '9')
+                {
+                    // ESC [ n ~ sequences: 1/7 home, 4/8 end, 3 delete
+                    read_key(&interrupted);
+                    key = b == '1' || b == '7' ? 'H' : b == '4' || b == '8' ? 'F' : b == '3' ? 'X' : 0;
+                }
+                else if (a == '[' || a == 'O')
+                {
+                    key = b;
+                }
+            }
+
+            if (key == 'A' || key == KEY_CTRL('P'))
+            {
+                char * entry = NULL;
+                long prev = history_prev(histPos, &entry);
+                if (prev >= 0)
+                {
+                    if (histPos == HISTORY_END)
+                        edited = strdup(buf);
+                    histPos = prev;
+                    line_set(&l, entry);
+                    free(entry);
+                }
+            }
+            else if ((key == 'B' || key == KEY_CTRL('N')) && histPos != HISTORY_END)
+            {
+                char * entry = NULL;
+                long next = history_next(histPos, &entry);
+                if (next >= 0)
+                {
+                    histPos = next;
+                    line_set(&l, entry);
+                    free(entry);
+                }
+                else
+                {
+                    histPos = HISTORY_END;
+                    line_set(&l, edited != NULL ? edited : "");
+                    free(edited);
+                    edited = NULL;
+                }
+            }
+            else if (key == 'C' && l.pos < l.len)
+                l.pos++;
+            else if (key == 'D' && l.pos > 0)
+                l.pos--;
+            else if (key == 'H')
+                l.pos = 0;
+            else if (key == 'F')
+                l.pos = l.len;
+            else if (key == 'X' && l.pos < l.len)
+                line_delete(&l, l.pos, 1);
+            break;
+        }
+        default:
+            if (c >= ' ')
+            {
+                char ch = c;
+                line_insert(&l, &ch, 1);
+            }
+            break;
+        }
+
+        lastTab = tab;
+
+        if (result != 0)
+            break;
+        refresh(&l);
+    }
+
+    free(edited);
+    raw_disable();
+    write(STDOUT_FILENO, "\r\n", 2);
+
+    if (result < 0)
+        return -1;
+
+    buf[l.len] = '\n';
+    buf[l.len + 1] = '\0';
+    return (int)l.len + 1;
+}
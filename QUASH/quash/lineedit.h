@@ -0,0 +1,28 @@
+/**
+ * @file lineedit.h
+ *
+ * A raw-mode terminal line editor with tab completion and history search.
+ */
+
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+#include <stddef.h>
+
+/**
+ * Reads one line from the terminal on stdin. Like fgets, the line keeps its
+ * trailing newline.
+ *
+ * Keys: Left/Right, Home/End (Ctrl-A/Ctrl-E), Backspace/Delete, Ctrl-U and
+ * Ctrl-K to kill, Up/Down to walk the history, Ctrl-R for reverse history
+ * search, Tab to complete, Ctrl-C to discard the line and Ctrl-D to end input
+ * on an empty line.
+ *
+ * @param prompt - printed before the line
+ * @param buf - receives the line
+ * @param size - size of buf
+ * @return the length of the line or -1 at end of input
+ */
+int lineedit_read(const char * prompt, char * buf, size_t size);
+
+#endif // LINEEDIT_H
@@ -0,0 +1,301 @@
+/**
+ * @file linesplit.c
+ *
+ * The file is mapped privately with at least one zero byte after its end,
+ * so every field can be terminated in place. Separators are found 64 bytes
+ * at a time as bitmasks, using AVX2 or SSE2 when the CPU has them. A first
+ * pass counts separators to size the argument arena exactly and a second
+ * pass fills it.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "linesplit.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINESPLIT_X86
+#endif
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define BLOCK (64)
+
+/**
+ * Finds the separators (space, '\r' and '\n') and the newlines in a 64 byte
+ * block. Bit i of each mask is set for byte i.
+ */
+typedef void (*scan_fn)(const unsigned char * p, uint64_t * sep, uint64_t * nl);
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void scan_scalar(const unsigned char * p, uint64_t * sep, uint64_t * nl)
+{
+    uint64_t s = 0, n = 0;
+
+    for (int i = 0; i < BLOCK; i++)
+    {
+        uint64_t bit = 1ULL << i;
+        if (p[i] == '\n')
+            n |= bit;
+        if (p[i] == ' ' || p[i] == '\n' || p[i] == '\r')
+            s |= bit;
+    }
+
+    *sep = s;
+    *nl = n;
+}
+
+#ifdef LINESPLIT_X86
+__attribute__((target("sse2")))
+static void scan_sse2(const unsigned char * p, uint64_t * sep, uint64_t * nl)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    uint64_t s = 0, n = 0;
+
+    for (int i = 0; i < BLOCK; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i isNl = _mm_cmpeq_epi8(v, newline);
+        __m128i isSep = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), isNl),
+                                     _mm_cmpeq_epi8(v, cr));
+
+        n |= (uint64_t)(uint16_t)_mm_movemask_epi8(isNl) << i;
+        s |= (uint64_t)(uint16_t)_mm_movemask_epi8(isSep) << i;
+    }
+
+    *sep = s;
+    *nl = n;
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(const unsigned char * p, uint64_t * sep, uint64_t * nl)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    uint64_t s = 0, n = 0;
+
+    for (int i = 0; i < BLOCK; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i isNl = _mm256_cmpeq_epi8(v, newline);
+        __m256i isSep = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), isNl),
+                                        _mm256_cmpeq_epi8(v, cr));
+
+        n |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isNl) << i;
+        s |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isSep) << i;
+    }
+
+    *sep = s;
+    *nl = n;
+}
+#endif
+
+static scan_fn pick_scanner()
+{
+#ifdef LINESPLIT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return scan_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return scan_sse2;
+#endif
+    return scan_scalar;
+}
+
+/**
+ * Scans the block at off, padding a short final block with zero bytes.
+ */
+static void scan_at(scan_fn scan, const char * buf, size_t len, size_t off,
+                    uint64_t * sep, uint64_t * nl)
+{
+    if (off + BLOCK <= len)
+    {
+        scan((const unsigned char *)buf + off, sep, nl);
+        return;
+    }
+
+    unsigned char tail[BLOCK] = {0};
+    memcpy(tail, buf + off, len - off);
+    scan(tail, sep, nl);
+}
+
+/**
+ * Maps a regular file with a zero byte after its end.
+ */
+static char * map_file(int fd, size_t size, size_t * mapLen)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    // Reserve one page more than the file covers; the part after the file
+    // stays anonymous zero pages
+    *mapLen = (size / page + 1) * page;
+    char * base = mmap(NULL, *mapLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    if (size > 0 &&
+        mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, *mapLen);
+        return NULL;
+    }
+
+    madvise(base, size, MADV_SEQUENTIAL);
+    return base;
+}
+
+/**
+ * Reads a file that cannot be mapped, such as a pipe.
+ */
+static char * read_file(int fd, size_t * size)
+{
+    size_t cap = 65536;
+    char * buf = malloc(cap);
+    ssize_t n;
+
+    *size = 0;
+    while ((n = read(fd, buf + *size, cap - *size - 1)) != 0)
+    {
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buf);
+            return NULL;
+        }
+
+        *size += n;
+        if (cap - *size - 1 == 0)
+        {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+    }
+
+    buf[*size] = '\0';
+    return buf;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+bool linesplit_open(const char * path, char * arg0, linesplit_t * ls)
+{
+    struct stat st;
+    size_t size;
+
+    memset(ls, 0, sizeof(linesplit_t));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        size = st.st_size;
+        ls->map = map_file(fd, size, &ls->mapLen);
+    }
+    else
+        ls->map = read_file(fd, &size);
+
+    int err = errno;
+    close(fd);
+    if (ls->map == NULL)
+    {
+        errno = err;
+        return false;
+    }
+
+    scan_fn scan = pick_scanner();
+    uint64_t sep, nl;
+    size_t numSep = 0, numNl = 0;
+
+    for (size_t off = 0; off < size; off += BLOCK)
+    {
+        scan_at(scan, ls->map, size, off, &sep, &nl);
+        numSep += __builtin_popcountll(sep);
+        numNl += __builtin_popcountll(nl);
+    }
+
+    // Each field ends at a separator or the end of the file, and each line
+    // adds arg0 and the NULL terminator
+    ls->argv = malloc((numSep + 1 + 2 * (numNl + 1)) * sizeof(char *));
+    ls->lineStart = malloc((numNl + 1) * sizeof(size_t));
+
+    size_t a = 0, line = 0, fieldStart = 0, lineBegin = 0;
+    ls->lineStart[0] = 0;
+    ls->argv[a++] = arg0;
+
+    for (size_t off = 0; off < size; off += BLOCK)
+    {
+        scan_at(scan, ls->map, size, off, &sep, &nl);
+
+        while (sep != 0)
+        {
+            int bit = __builtin_ctzll(sep);
+            size_t p = off + bit;
+
+            if (p > fieldStart)
+            {
+                ls->argv[a++] = ls->map + fieldStart;
+                ls->map[p] = '\0';
+            }
+
+            if (nl & (1ULL << bit))
+            {
+                ls->argv[a++] = NULL;
+                ls->lineStart[++line] = a;
+                ls->argv[a++] = arg0;
+                lineBegin = p + 1;
+            }
+
+            fieldStart = p + 1;
+            sep &= sep - 1;
+        }
+    }
+
+    // A last line without a newline; the byte after the file is zero
+    if (lineBegin < size)
+    {
+        if (fieldStart < size)
+            ls->argv[a++] = ls->map + fieldStart;
+        ls->argv[a++] = NULL;
+        line++;
+    }
+
+    ls->numLines = line;
+    return true;
+}
+
+char ** linesplit_line(const linesplit_t * ls, size_t line)
+{
+    return &ls->argv[ls->lineStart[line]];
+}
+
+void linesplit_close(linesplit_t * ls)
+{
+    if (ls->mapLen > 0)
+        munmap(ls->map, ls->mapLen);
+    else
+        free(ls->map);
+
+    free(ls->argv);
+    free(ls->lineStart);
+    memset(ls, 0, sizeof(linesplit_t));
+}
@@ -0,0 +1,46 @@
+/**
+ * @file linesplit.h
+ *
+ * Splits a file into lines and space separated fields for the `cmd < file`
+ * loop, building every line's argument vector at once.
+ */
+
+#ifndef LINESPLIT_H
+#define LINESPLIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A split file. The fields point into a private mapping of the file.
+ */
+typedef struct linesplit_t {
+    char * map;          ///< file contents, separators replaced by '\0'
+    size_t mapLen;       ///< length of the mapping
+    char ** argv;        ///< all argument vectors, each ending in NULL
+    size_t * lineStart;  ///< index in argv where each line's vector starts
+    size_t numLines;
+} linesplit_t;
+
+/**
+ * Maps path and splits it. Every line becomes arg0 followed by the line's
+ * fields; lines and fields may be of any length.
+ *
+ * @param path - the file to split
+ * @param arg0 - first argument of every line's vector
+ * @param ls - receives the split file
+ * @return True on success and false with errno set otherwise
+ */
+bool linesplit_open(const char * path, char * arg0, linesplit_t * ls);
+
+/**
+ * Gets the NULL terminated argument vector of a line.
+ */
+char ** linesplit_line(const linesplit_t * ls, size_t line);
+
+/**
+ * Unmaps the file and frees the argument vectors.
+ */
+void linesplit_close(linesplit_t * ls);
+
+#endif // LINESPLIT_H
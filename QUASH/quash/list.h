@@ -10,6 +10,11 @@ struct test_struct
     int job_id;
     int job_pid;
     char job_name[256];
+    char job_cgroup[256];//cgroup the job was placed in, "" if none
+    char job_coproc[64];//coprocess name, "" if the job is not one
+    int job_in;//pipe to the coprocess's stdin, -1 if none
+    FILE * job_out;//pipe from the coprocess's stdout, NULL if none
+    bool job_exited;//the coprocess was reaped, but recv has not read all its output
 
     struct test_struct *next;
 };
@@ -30,6 +35,11 @@ struct test_struct* create_list(int job_pid, char * job_name)
     ptr->job_id = job_id_count++;
     ptr->job_pid = job_pid;
     strcpy(ptr->job_name,job_name);
+    ptr->job_cgroup[0] = '\0';
+    ptr->job_coproc[0] = '\0';
+    ptr->job_in = -1;
+    ptr->job_out = NULL;
+    ptr->job_exited = false;
     ptr->next = NULL;
 
     head = curr = ptr;
@@ -52,6 +62,11 @@ struct test_struct* add_to_list(int job_pid, char * job_name)
     ptr->job_id = job_id_count++;
     ptr->job_pid = job_pid;
     strcpy(ptr->job_name,job_name);
+    ptr->job_cgroup[0] = '\0';
+    ptr->job_coproc[0] = '\0';
+    ptr->job_in = -1;
+    ptr->job_out = NULL;
+    ptr->job_exited = false;
     ptr->next = NULL;
 
     curr->next = ptr;
@@ -124,6 +139,22 @@ int search_by_job_id(int job_id)
     }
 }
 
+struct test_struct* search_by_coproc(const char * name)
+{
+    struct test_struct *ptr = head;
+
+    while(ptr != NULL)
+    {
+        if(!strcmp(ptr->job_coproc, name))
+        {
+            return ptr;
+        }
+        ptr = ptr->next;
+    }
+
+    return NULL;
+}
+
 int delete_from_list(int job_pid)
 {
     struct test_struct *prev = NULL;
@@ -0,0 +1,385 @@
+/**
+ * @file memo.c
+ *
+ * The cache lives in $QUASH_MEMO, or ~/.quash_memo, as two directories:
+ * entries/<key> holds "status stdout-hash stderr-hash" and objects/<hash>
+ * holds output contents, so identical outputs are stored once. Files are
+ * written under a temporary name and renamed into place, which keeps
+ * concurrent shells from ever seeing half-written results.
+ *
+ * Hashes are 128 bits made of two independent 64 bit streams: FNV-1a and a
+ * multiply-xorshift mix.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "memo.h"
+#include "redirect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define MEMO_MAGIC "QUASHMEMO1"
+#define FNV_OFFSET (0xcbf29ce484222325ULL)
+#define FNV_PRIME (0x100000001b3ULL)
+#define MIX_SEED (0x9e3779b97f4a7c15ULL)
+
+/**
+ * A running 128 bit hash.
+ */
+typedef struct hash_t {
+    uint64_t a;
+    uint64_t b;
+} hash_t;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void hash_init(hash_t * h)
+{
+    h->a = FNV_OFFSET;
+    h->b = MIX_SEED;
+}
+
+static void hash_bytes(hash_t * h, const void * data, size_t len)
+{
+    const unsigned char * p = data;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        h->a = (h->a ^ p[i]) * FNV_PRIME;
+        h->b = (h->b ^ p[i]) * MIX_SEED;
+        h->b ^= h->b >> 29;
+    }
+}
+
+/**
+ * Hashes a length prefixed field so "ab","c" and "a","bc" differ.
+ */
+static void hash_field(hash_t * h, const char * tag, const void * data, size_t len)
+{
+    uint64_t n = len;
+
+    hash_bytes(h, tag, strlen(tag) + 1);
+    hash_bytes(h, &n, sizeof(n));
+    hash_bytes(h, data, len);
+}
+
+static void hash_string(hash_t * h, const char * tag, const char * s)
+{
+    hash_field(h, tag, s, s != NULL ? strlen(s) : 0);
+}
+
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void hash_hex(const hash_t * h, char out[MEMO_KEY_SIZE])
+{
+    snprintf(out, MEMO_KEY_SIZE, "%016llx%016llx",
+             (unsigned long long)mix(h->a), (unsigned long long)mix(h->b ^ h->a));
+}
+
+/**
+ * Hashes what identifies a file's version: size, mtime and inode.
+ */
+static void hash_file_stamp(hash_t * h, const char * tag, const char * path)
+{
+    struct stat st;
+
+    hash_string(h, tag, path);
+    if (stat(path, &st) != 0)
+    {
+        hash_string(h, "missing", path);
+        return;
+    }
+
+    uint64_t stamp[5] = {
+        (uint64_t)st.st_size, (uint64_t)st.st_mtim.tv_sec, (uint64_t)st.st_mtim.tv_nsec,
+        (uint64_t)st.st_ino, (uint64_t)st.st_dev
+    };
+    hash_field(h, "stamp", stamp, sizeof(stamp));
+}
+
+/**
+ * Finds the file quash would run for name: like checkWkdir(), a file of that
+ * name under $WKDIR first, then whatever execvp() would find.
+ *
+ * @return True if path was filled in and false otherwise
+ */
+static bool resolve_command(const char * name, char * path, size_t len)
+{
+    const char * wkdir = getenv("WKDIR");
+
+    if (wkdir != NULL && snprintf(path, len, "%s/%s", wkdir, name) < (int)len && access(path, R_OK) == 0)
+        return true;
+
+    if (strchr(name, '/') != NULL)
+    {
+        snprintf(path, len, "%s", name);
+        return true;
+    }
+
+    const char * dirs = getenv("PATH");
+    while (dirs != NULL && *dirs != '\0')
+    {
+        const char * end = strchr(dirs, ':');
+        int dlen = end != NULL ? (int)(end - dirs) : (int)strlen(dirs);
+
+        snprintf(path, len, "%.*s/%s", dlen, dlen > 0 ? dirs : ".", name);
+        if (access(path, X_OK) == 0)
+            return true;
+
+        dirs = end != NULL ? end + 1 : NULL;
+    }
+    return false;
+}
+
+static bool cache_dir(const char * sub, char * path, size_t len)
+{
+    const char * root = getenv("QUASH_MEMO");
+    char base[256];
+
+    int n;
+
+    if (root != NULL)
+        n = snprintf(base, sizeof(base), "%s", root);
+    else
+        n = snprintf(base, sizeof(base), "%s/.quash_memo", getenv("HOME"));
+
+    if (n >= (int)sizeof(base) || (mkdir(base, 0755) != 0 && errno != EEXIST))
+        return false;
+
+    if (snprintf(path, len, "%s/%s", base, sub) >= (int)len)
+        return false;
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+/**
+ * Makes a temporary file in the cache that is not passed on to children.
+ */
+static int temp_file(char * path, size_t len)
+{
+    char dir[256];
+
+    if (!cache_dir("tmp", dir, sizeof(dir)))
+        return -1;
+
+    snprintf(path, len, "%s/capture.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+
+    int high = fcntl(fd, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+    close(fd);
+    if (high < 0)
+        unlink(path);
+    return high;
+}
+
+static bool write_all(int fd, const char * buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * Moves a captured file to objects/ under the hash of its contents.
+ */
+static bool store_object(const char * tmpPath, int fd, char hash[MEMO_KEY_SIZE])
+{
+    char buf[65536];
+    char dir[256], path[512];
+    hash_t h;
+    ssize_t n;
+
+    hash_init(&h);
+    lseek(fd, 0, SEEK_SET);
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        hash_bytes(&h, buf, n);
+    close(fd);
+    hash_hex(&h, hash);
+
+    if (n < 0 || !cache_dir("objects", dir, sizeof(dir)))
+    {
+        unlink(tmpPath);
+        return false;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", dir, hash);
+    if (access(path, F_OK) == 0)
+    {
+        unlink(tmpPath);
+        return true;
+    }
+
+    return rename(tmpPath, path) == 0;
+}
+
+static bool replay_object(const char * hash, int fd)
+{
+    char dir[256], path[512], buf[65536];
+    ssize_t n;
+
+    if (!cache_dir("objects", dir, sizeof(dir)))
+        return false;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, hash);
+    int in = open(path, O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+
+    bool ok = true;
+    while (ok && (n = read(in, buf, sizeof(buf))) > 0)
+        ok = write_all(fd, buf, n);
+
+    close(in);
+    return ok && n == 0;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+void memo_key(char * const * argv, char * const * envVars, char * const * deps,
+              const char * inputFile, char key[MEMO_KEY_SIZE])
+{
+    char path[4096];
+    hash_t h;
+
+    hash_init(&h);
+
+    for (int i = 0; argv[i] != NULL; i++)
+        hash_string(&h, "arg", argv[i]);
+
+    if (getcwd(path, sizeof(path)) != NULL)
+        hash_string(&h, "cwd", path);
+
+    // cd only moves $WKDIR, which is where quash looks for argv[0] first
+    if (getenv("WKDIR") != NULL)
+        hash_string(&h, "wkdir", getenv("WKDIR"));
+
+    // A rebuilt or upgraded program must not reuse the old results
+    if (resolve_command(argv[0], path, sizeof(path)))
+        hash_file_stamp(&h, "exe", path);
+
+    for (int i = 0; envVars[i] != NULL; i++)
+    {
+        hash_string(&h, "env", envVars[i]);
+        hash_string(&h, getenv(envVars[i]) != NULL ? "set" : "unset", getenv(envVars[i]));
+    }
+
+    if (inputFile != NULL && inputFile[0] != '\0')
+        hash_file_stamp(&h, "input", inputFile);
+
+    for (int i = 0; deps[i] != NULL; i++)
+        hash_file_stamp(&h, "dep", deps[i]);
+
+    hash_hex(&h, key);
+}
+
+bool memo_lookup(const char * key, memo_entry_t * entry)
+{
+    char dir[256], path[512], magic[16];
+    bool found = false;
+
+    if (!cache_dir("entries", dir, sizeof(dir)))
+        return false;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, key);
+    FILE * f = fopen(path, "re");
+    if (f == NULL)
+        return false;
+
+    if (fscanf(f, "%15s %d %32s %32s", magic, &entry->status, entry->out, entry->err) == 4 &&
+        !strcmp(magic, MEMO_MAGIC))
+    {
+        // Objects removed by hand make the entry useless
+        char obj[256];
+        if (cache_dir("objects", obj, sizeof(obj)))
+        {
+            char outPath[512], errPath[512];
+            snprintf(outPath, sizeof(outPath), "%s/%s", obj, entry->out);
+            snprintf(errPath, sizeof(errPath), "%s/%s", obj, entry->err);
+            found = access(outPath, R_OK) == 0 && access(errPath, R_OK) == 0;
+        }
+    }
+
+    fclose(f);
+    return found;
+}
+
+bool memo_replay(const memo_entry_t * entry, int outFd, int errFd)
+{
+    bool out = replay_object(entry->out, outFd);
+    bool err = replay_object(entry->err, errFd);
+    return out && err;
+}
+
+bool memo_capture_begin(memo_capture_t * cap)
+{
+    cap->outFd = temp_file(cap->outPath, sizeof(cap->outPath));
+    if (cap->outFd < 0)
+        return false;
+
+    cap->errFd = temp_file(cap->errPath, sizeof(cap->errPath));
+    if (cap->errFd < 0)
+    {
+        close(cap->outFd);
+        unlink(cap->outPath);
+        return false;
+    }
+    return true;
+}
+
+bool memo_capture_end(memo_capture_t * cap, const char * key, int status, bool store,
+                      memo_entry_t * entry)
+{
+    char dir[256], tmp[512], path[512];
+
+    entry->status = status;
+    bool out = store_object(cap->outPath, cap->outFd, entry->out);
+    bool err = store_object(cap->errPath, cap->errFd, entry->err);
+    if (!out || !err)
+        return false;
+
+    if (!store || !cache_dir("entries", dir, sizeof(dir)))
+        return true;
+
+    snprintf(tmp, sizeof(tmp), "%s/.%s.%d", dir, key, (int)getpid());
+    snprintf(path, sizeof(path), "%s/%s", dir, key);
+
+    FILE * f = fopen(tmp, "we");
+    if (f == NULL)
+        return true;
+
+    fprintf(f, "%s %d %s %s\n", MEMO_MAGIC, status, entry->out, entry->err);
+    if (fclose(f) != 0 || rename(tmp, path) != 0)
+        unlink(tmp);
+
+    return true;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file memo.h
+ *
+ * On-disk cache of command results for the memo builtin. A result is found
+ * by a key hashed from everything the command is assumed to depend on and
+ * holds the exit status plus the stdout and stderr contents, which are
+ * stored once per distinct content.
+ */
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdbool.h>
+
+/**
+ * Size of a key or content hash as a hex string, including the terminator.
+ */
+#define MEMO_KEY_SIZE (33)
+
+/**
+ * A cached result.
+ */
+typedef struct memo_entry_t {
+    int status;               ///< wait status of the command
+    char out[MEMO_KEY_SIZE];  ///< content hash of stdout
+    char err[MEMO_KEY_SIZE];  ///< content hash of stderr
+} memo_entry_t;
+
+/**
+ * Output files of a command being recorded.
+ */
+typedef struct memo_capture_t {
+    int outFd;
+    int errFd;
+    char outPath[512];
+    char errPath[512];
+} memo_capture_t;
+
+/**
+ * Hashes a command and its inputs into a key: argv, the working directory
+ * and $WKDIR, the executable argv[0] resolves to as quash would run it, the
+ * named environment variables, and the size, mtime and inode of the input
+ * file and each dependency.
+ *
+ * @param argv - NULL terminated arguments
+ * @param envVars - NULL terminated environment variable names
+ * @param deps - NULL terminated dependency paths
+ * @param inputFile - the redirected input or "" for none
+ * @param key - receives the key
+ */
+void memo_key(char * const * argv, char * const * envVars, char * const * deps,
+              const char * inputFile, char key[MEMO_KEY_SIZE]);
+
+/**
+ * Looks up a cached result.
+ *
+ * @return True if key has a result whose outputs are all present
+ */
+bool memo_lookup(const char * key, memo_entry_t * entry);
+
+/**
+ * Writes a result's stdout and stderr to outFd and errFd.
+ *
+ * @return True if both outputs could be written and false otherwise
+ */
+bool memo_replay(const memo_entry_t * entry, int outFd, int errFd);
+
+/**
+ * Creates the files a command's stdout and stderr are captured in.
+ *
+ * @return True if the cache is usable and false otherwise
+ */
+bool memo_capture_begin(memo_capture_t * cap);
+
+/**
+ * Moves captured output into the cache and fills entry with it. The result
+ * is only findable under key afterwards if store is set.
+ *
+ * @return True if the output was kept and false otherwise
+ */
+bool memo_capture_end(memo_capture_t * cap, const char * key, int status, bool store,
+                      memo_entry_t * entry);
+
+#endif // MEMO_H
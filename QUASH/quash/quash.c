@@ -10,6 +10,15 @@
 #include "quash.h" // Putting this above the other includes allows us to ensure
 // this file's headder's #include statements are self
 // contained.
+#include "glob_expand.h"
+#include "history.h"
+#include "complete.h"
+#include "lineedit.h"
+#include "joblimits.h"
+#include "redirect.h"
+#include "memo.h"
+#include "dag.h"
+#include "linesplit.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -32,6 +41,27 @@
 static bool running;
 sigjmp_buf env;
 int status;
+/**
+ * Holds the paths produced by glob expansion of the current command. The
+ * command's execArgs point into it until the next command is read.
+ */
+static glob_list_t globArgs;
+/**
+ * Builtin command names offered by tab completion.
+ */
+static const char * const builtins[] = {
+    "cd", "cgroup", "coproc", "echo", "exec", "exit", "history", "jobs", "kill", "memo",
+    "pwd", "quit", "recv", "send", "set", "ulimit", "wait", NULL
+};
+
+/**
+ * Builtins that change shell state. In parallel mode they wait for every
+ * earlier line and every later line waits for them.
+ */
+static const char * const barriers[] = {
+    "cd", "cgroup", "coproc", "exec", "exit", "kill", "q", "quit", "recv", "send", "set",
+    "ulimit", "wait", NULL
+};
 
 /**************************************************************************
  * Private Functions 
@@ -43,19 +73,251 @@ static void start() {
   running = true;
 }
 
+/**
+ * Adds word to execArgs at index i, replacing it with its pathname expansion
+ * if it has glob characters and matches anything.
+ *
+ * @return the index after the last argument added
+ */
+static int addArg(char ** execArgs, int i, char * word)
+{
+    int first = globArgs.count;
+
+    if( !glob_has_magic(word) || glob_expand(word, &globArgs) == 0 )
+    {
+        execArgs[i] = word;
+        return i + 1;
+    }
+
+    for(int j = first; j < globArgs.count; j++)
+    {
+        if(i >= MAX_PATH_LENGTH - 1)
+        {
+            printf("Error: %s matches too many files\n", word);
+            break;
+        }
+        execArgs[i] = globArgs.paths[j];
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Finds the text of a command line after its first n words, as it was typed.
+ *
+ * @return the start of the rest of the line, with its length, up to any
+ * redirection and without trailing spaces, in len
+ */
+static char * afterWords(command_t * cmd, int n, size_t * len)
+{
+    char * p = cmd->cmdstr;
+    char * end = cmd->cmdstr + cmd->argslen;
+
+    for( ; n >= 0 && p < end; n--)
+    {
+        while(p < end && *p == ' ')
+            p++;
+        while(n > 0 && p < end && *p != ' ')
+            p++;
+    }
+    while(end > p && end[-1] == ' ')
+        end--;
+
+    *len = end - p;
+    return p;
+}
+
+/**
+ * Checks if a word is a redirection operator.
+ */
+static bool isRedirect(const char * word)
+{
+    return word[0] == '<' || word[0] == '>' || !strncmp(word, "2>", 2) || !strncmp(word, "&>", 2);
+}
+
+/**
+ * Records the redirection operator op in cmd, reading the file name after it
+ * with strtok() if it takes one. A later redirection of a stream replaces an
+ * earlier one, as in sh.
+ *
+ * @return True if op is a complete redirection and false otherwise
+ */
+static bool parseRedirect(command_t * cmd, char * op)
+{
+    if( !strncmp(op, ">&", 2) || !strncmp(op, "2>&", 3) )
+    {
+        char * end;
+        char * num = strchr(op, '&') + 1;
+        int fd = (int)strtol(num, &end, 10);
+
+        if( end == num || *end != '\0' )
+            return false;
+
+        if( op[0] == '2' )
+        {
+            strcpy(cmd->errorFile, "");
+            cmd->errorFd = fd;
+            cmd->errorFirst = !strcmp(cmd->outputFile, "") && cmd->outputFd < 0;
+        }
+        else
+        {
+            strcpy(cmd->outputFile, "");
+            cmd->outputFd = fd;
+        }
+        return true;
+    }
+
+    char * file = strtok(NULL, " ");
+    if( file == NULL )
+        return false;
+
+    if( !strcmp(op, "<") )
+        strcpy(cmd->inputFile, file);
+    else if( !strcmp(op, ">") || !strcmp(op, ">>") )
+    {
+        strcpy(cmd->outputFile, file);
+        cmd->outputAppend = op[1] == '>';
+        cmd->outputFd = -1;
+    }
+    else if( !strcmp(op, "2>") || !strcmp(op, "2>>") )
+    {
+        strcpy(cmd->errorFile, file);
+        cmd->errorAppend = op[2] == '>';
+        cmd->errorFd = -1;
+    }
+    else if( !strcmp(op, "&>") || !strcmp(op, "&>>") )
+    {
+        strcpy(cmd->outputFile, file);
+        cmd->outputAppend = op[2] == '>';
+        cmd->outputFd = -1;
+        strcpy(cmd->errorFile, "");
+        cmd->errorFd = 1;
+        cmd->errorFirst = false;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * Opens the output redirections of cmd in the shell so a cached descriptor
+ * can be handed to the child instead of reopening the file there.
+ *
+ * @return True if every target could be opened and false otherwise
+ */
+static bool openRedirects(command_t * cmd, int * out, int * err)
+{
+    *out = cmd->outputFd;
+    *err = cmd->errorFd == 1 ? -1 : cmd->errorFd;
+
+    if( (*out >= 0 && fcntl(*out, F_GETFD) < 0) || (*err >= 0 && fcntl(*err, F_GETFD) < 0) )
+    {
+        printf("Error: %d is not an open descriptor\n", *out >= 0 ? *out : *err);
+        return false;
+    }
+
+    if( strcmp(cmd->outputFile, "") &&
+        (*out = redirect_open(cmd->outputFile, cmd->outputAppend)) < 0 )
+    {
+        fprintf(stderr, "Cannot open %s. ERROR# %d\n", cmd->outputFile, errno);
+        return false;
+    }
+
+    if( strcmp(cmd->errorFile, "") &&
+        (*err = redirect_open(cmd->errorFile, cmd->errorAppend)) < 0 )
+    {
+        fprintf(stderr, "Cannot open %s. ERROR# %d\n", cmd->errorFile, errno);
+        if( strcmp(cmd->outputFile, "") )
+            redirect_release(*out);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Points stdout and stderr at the descriptors from openRedirects(), in the
+ * order the command gave them.
+ */
+static void applyRedirects(command_t * cmd, int out, int err)
+{
+    //2>&1 before > keeps stderr on the old stdout
+    if( cmd->errorFd == 1 && cmd->errorFirst )
+        dup2(STDOUT_FILENO, STDERR_FILENO);
+
+    if( out >= 0 )
+        dup2(out, STDOUT_FILENO);
+
+    if( cmd->errorFd == 1 && !cmd->errorFirst )
+        dup2(STDOUT_FILENO, STDERR_FILENO);//2>&1 and &> follow stdout
+    else if( err >= 0 )
+        dup2(err, STDERR_FILENO);
+}
+
+/**
+ * Releases the descriptors openRedirects() opened from files.
+ */
+static void closeRedirects(command_t * cmd, int out, int err)
+{
+    if( strcmp(cmd->outputFile, "") )
+        redirect_release(out);
+    if( strcmp(cmd->errorFile, "") )
+        redirect_release(err);
+}
+
 /**************************************************************************
  * Public Functions 
  **************************************************************************/
+/**
+ * Removes a reaped background job from the job list along with its cgroup
+ * and coprocess input. A coprocess whose output recv has not finished
+ * reading stays listed until closeCoproc() is called for it; this runs in the
+ * SIGCHLD handler, so the stream is not closed here.
+ */
+static void reapJob(pid_t pid)
+{
+    struct test_struct * job = search_in_list(pid, NULL);
+
+    if(job != NULL)
+    {
+        cgroup_remove(job->job_cgroup);
+        job->job_cgroup[0] = '\0';
+        if(job->job_in >= 0)
+            close(job->job_in);
+        job->job_in = -1;
+
+        if(job->job_out != NULL)
+        {
+            job->job_exited = true;
+            return;
+        }
+    }
+    delete_from_list(pid);
+}
+
+/**
+ * Closes a coprocess's output, removing it from the job list if it has
+ * already been reaped. Must be called with SIGCHLD blocked.
+ */
+static void closeCoproc(struct test_struct * job)
+{
+    fclose(job->job_out);
+    job->job_out = NULL;
+    if(job->job_exited)
+        delete_from_list(job->job_pid);
+}
+
 void catchChild(int signum)//child return or terminate callback
 {
     //printf("Child died!%d\n",signum);
     pid_t pid;
     int status;
-    delete_from_list(waitpid(-1,&status,WNOHANG));
+    reapJob(waitpid(-1,&status,WNOHANG));
     
     while((pid = waitpid(-1,&status,WNOHANG|WUNTRACED)) != -1)
     {
-        delete_from_list(pid);
+        reapJob(pid);
         return;
 
         // if (WIFEXITED(status))
@@ -134,6 +396,37 @@ void jobs()
     return;
 }
 
+void history(command_t cmd)
+{
+    if (cmd.execArgs[1] == NULL)
+    {
+        history_print(stdout, -1);
+    }
+    else if (!strcmp(cmd.execArgs[1], "-s") && cmd.execArgs[2] != NULL)
+    {
+        //search for the rest of the command line, newest match first
+        char query[MAX_COMMAND_LENGTH];
+        size_t len;
+        char * text = afterWords(&cmd, 2, &len);
+        long pos = HISTORY_END;
+
+        memcpy(query, text, len);
+        query[len] = '\0';
+        char * line;
+
+        while ((pos = history_search(query, pos, &line)) >= 0)
+        {
+            printf("%s\n", line);
+            free(line);
+        }
+    }
+    else
+    {
+        history_print(stdout, atoi(cmd.execArgs[1]));
+    }
+    return;
+}
+
 int exec_pipes(command_t cmd)
 {
     sigset_t tmpSa;
@@ -143,10 +436,29 @@ int exec_pipes(command_t cmd)
     sigprocmask(SIG_SETMASK, &tmpSa, NULL);
     //Start blocking signals
 
+    int out, err;
+    if(!openRedirects(&cmd, &out, &err))
+    {
+        sigfillset( &tmpSa);
+        sigdelset(&tmpSa,SIGINT);
+        sigdelset(&tmpSa,SIGTSTP);
+        sigdelset(&tmpSa, SIGCHLD);
+        sigprocmask(SIG_SETMASK, &tmpSa, NULL);
+        //Stop blocking signals
+        return EXIT_FAILURE;
+    }
+
+    char cgroup[MAX_PATH_LENGTH] = "";
+    if(cmd.execBg)
+        cgroup_create(cgroup, sizeof(cgroup));
+
     int ppid;
     ppid = fork();
     if(!ppid)
     {    
+        limits_apply();
+        cgroup_join(cgroup);//the whole pipeline shares the job's cgroup
+
         char tmpcmdstr [MAX_COMMAND_LENGTH];
                 
         command_t cmd_a[MAX_COMMAND_LENGTH];
@@ -187,17 +499,15 @@ int exec_pipes(command_t cmd)
                 {
                     close(fd_a[j]);
                 }
-                if(strcmp(cmd.outputFile,"")&&(i==numCommands-1))
+                if(i==numCommands-1)
                 {
-                    execToFile(cmd_a[i].execArgs, cmd.outputFile);
+                    applyRedirects(&cmd, out, err);//redirections belong to the last command
                 }
-                else
+
+                checkWkdir(cmd.execArgs[0]);
+                if((execvp(cmd_a[i].execArgs[0],cmd_a[i].execArgs)) < 0)
                 {
-                    checkWkdir(cmd.execArgs[0]);
-                    if((execvp(cmd_a[i].execArgs[0],cmd_a[i].execArgs)) < 0)
-                    {
-                        fprintf(stderr,"\nError execing %s. ERROR# %d",cmd_a[i].execArgs[0],errno);
-                    }
+                    fprintf(stderr,"\nError execing %s. ERROR# %d",cmd_a[i].execArgs[0],errno);
                 }
                 
                 exit(0);
@@ -222,16 +532,20 @@ int exec_pipes(command_t cmd)
     }
     else
     {
+        closeRedirects(&cmd, out, err);
+
         if(cmd.execBg)
         {
+            struct test_struct * job = add_to_list(ppid, cmd.cmdstr);
+            if(job != NULL)
+                strcpy(job->job_cgroup, cgroup);
+
             sigfillset( &tmpSa);
             sigdelset(&tmpSa,SIGINT);
             sigdelset(&tmpSa,SIGTSTP);
             sigdelset(&tmpSa, SIGCHLD);
             sigprocmask(SIG_SETMASK, &tmpSa, NULL);
             //Stop blocking signals       
-                 
-            add_to_list(ppid, cmd.cmdstr);
         }
         else if((waitpid(ppid,&status,0)) == -1)
         {
@@ -262,57 +576,51 @@ int exec_pipes(command_t cmd)
 
 int exec_cmd(command_t cmd)
 {
+    int out, err;
+    if(!openRedirects(&cmd, &out, &err))
+        return EXIT_FAILURE;
+
+    sigset_t tmpSa, oldSa;
+    sigfillset( &tmpSa);
+    sigdelset(&tmpSa,SIGINT);
+    sigdelset(&tmpSa,SIGTSTP);
+    sigprocmask(SIG_SETMASK, &tmpSa, &oldSa);
+    //Start blocking signals, so catchChild cannot reap a background job before it is listed
+
+    char cgroup[MAX_PATH_LENGTH] = "";
+    if(cmd.execBg)
+        cgroup_create(cgroup, sizeof(cgroup));
 
     pid_t pid = fork();
 	if(!pid)
     {
-        if( strcmp(cmd.inputFile,"") )
-        {          
-            char string[MAX_COMMAND_LENGTH];
-            FILE * file = fopen(cmd.inputFile, "r");
+        sigprocmask(SIG_SETMASK, &oldSa, NULL);
+        limits_apply();
+        cgroup_join(cgroup);
+        applyRedirects(&cmd, out, err);
 
-            while(fgets(string, MAX_COMMAND_LENGTH, file) != NULL)
+        if( strcmp(cmd.inputFile,"") )
+        {
+            //each line of the file gives the arguments of one run
+            linesplit_t input;
+            if(!linesplit_open(cmd.inputFile, cmd.execArgs[0], &input))
             {
-                char* args[MAX_PATH_LENGTH];
-
-                size_t len = strlen(string);
-                char last_char = string[len - 1];
-
-                if (last_char == '\n' || last_char == '\r')
-                {
-                    string[len - 1] = '\0';
-                    len = len - 1;
-                }
-
-                args[0] = cmd.execArgs[0];
-
-                char * temp;
-                temp = strtok(string," ");
-                args[1] = temp;
+                fprintf(stderr, "Cannot read %s. ERROR# %d\n", cmd.inputFile, errno);
+                exit(EXIT_FAILURE);
+            }
 
-                int i = 2;
-                while(((temp = strtok(NULL," ")) != NULL) && (i<255))
-                {
-                    args[i] = temp;
-                    i++;
-                }
-                args[i] = NULL;
+            for(size_t line = 0; line < input.numLines; line++)
+            {
+                char ** args = linesplit_line(&input, line);
 
                 int pid2 = fork();
                 if(!pid2)
                 {
-                    if(strcmp(cmd.outputFile,""))
-                    {
-                        execToFile(args, cmd.outputFile);
-                    }
-                    else
+                    checkWkdir(cmd.execArgs[0]);
+                    if(execvp(cmd.execArgs[0],args)<0)
                     {
-                        checkWkdir(cmd.execArgs[0]);
-                        if(execvp(cmd.execArgs[0],args)<0)
-                        {
-                            fprintf(stderr, "Error execing %s. Error# %d\n",cmd.cmdstr, errno);
-                            exit(EXIT_FAILURE);
-                        }
+                        fprintf(stderr, "Error execing %s. Error# %d\n",cmd.cmdstr, errno);
+                        exit(EXIT_FAILURE);
                     }
                 }
                 else
@@ -323,13 +631,9 @@ int exec_cmd(command_t cmd)
                         return EXIT_FAILURE;
                     }
                 }
-                
             }
-            
-        }
-        else if (strcmp(cmd.outputFile,""))
-        {
-            execToFile(cmd.execArgs, cmd.outputFile);
+
+            linesplit_close(&input);
         }
         else
         {
@@ -350,13 +654,7 @@ int exec_cmd(command_t cmd)
 	}
     else
     {
-
-        sigset_t tmpSa;
-        sigfillset( &tmpSa);
-        sigdelset(&tmpSa,SIGINT);
-        sigdelset(&tmpSa,SIGTSTP);
-        sigprocmask(SIG_SETMASK, &tmpSa, NULL);
-        //Start blocking signals
+        closeRedirects(&cmd, out, err);
 
         if(!cmd.execBg)
         {
@@ -381,6 +679,10 @@ int exec_cmd(command_t cmd)
         }
         else
         {
+            struct test_struct * job = add_to_list(pid, cmd.execArgs[0]);
+            if(job != NULL)
+                strcpy(job->job_cgroup, cgroup);
+
             sigfillset( &tmpSa);
             sigdelset(&tmpSa,SIGINT);
             sigdelset(&tmpSa,SIGTSTP);
@@ -388,27 +690,298 @@ int exec_cmd(command_t cmd)
             sigprocmask(SIG_SETMASK, &tmpSa, NULL);
             //Stop blocking???
             printf("[%d] is running\n", pid);
-
-            add_to_list(pid, cmd.execArgs[0]);
         }
     }
     return(0);
 }
 
-void execToFile(char ** execArgs, char * outputFile)
+void exec(command_t cmd)
 {
-    //cmd.execArgs[cmd.execNumArgs-2] = NULL;
-    //call exec as normal
-    int file = open(outputFile,O_CREAT|O_APPEND|O_WRONLY,S_IRWXU);
-    dup2(file, 1);
-    checkWkdir(execArgs[0]);
-    if(execvp(execArgs[0],execArgs)<0)
+    if(cmd.execArgs[1] == NULL)
     {
-        fprintf(stderr, "Error execing %s. Error# %d\n",execArgs[0], errno);
-        exit(EXIT_FAILURE);
+        printf("Usage: exec N> file | N>> file | N< file | N>&M | N>&- ...\n");
+        return;
+    }
+
+    for(int i = 1; cmd.execArgs[i] != NULL; i++)
+    {
+        char * spec = cmd.execArgs[i];
+        size_t len = strlen(spec);
+        //operators ending in > or < take the next word as their file
+        bool takesFile = spec[len-1] == '>' || spec[len-1] == '<';
+        char * file = takesFile ? cmd.execArgs[i+1] : NULL;
+
+        if(!redirect_persist(spec, file))
+            return;
+        if(takesFile && file != NULL)
+            i++;
     }
-    //puting things back the way they were.
-    close(file);
+}
+
+void coproc(command_t cmd)
+{
+    if(cmd.execArgs[1] == NULL || cmd.execArgs[2] == NULL)
+    {
+        printf("Usage: coproc NAME command [args]\n");
+        return;
+    }
+
+    sigset_t chld, old;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &old);
+
+    //a coprocess that has exited gives up its name, and any output left unread
+    struct test_struct * old_job = search_by_coproc(cmd.execArgs[1]);
+    if(old_job != NULL && old_job->job_exited)
+    {
+        closeCoproc(old_job);
+        old_job = NULL;
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+
+    if(old_job != NULL)
+    {
+        printf("Error: coproc %s is already running\n", cmd.execArgs[1]);
+        return;
+    }
+
+    int toChild[2], fromChild[2];
+    if(pipe(toChild) < 0)
+    {
+        fprintf(stderr, "Cannot create pipe. ERROR# %d\n", errno);
+        return;
+    }
+    if(pipe(fromChild) < 0)
+    {
+        fprintf(stderr, "Cannot create pipe. ERROR# %d\n", errno);
+        close(toChild[0]);
+        close(toChild[1]);
+        return;
+    }
+
+    //the shell's ends must not leak into later commands, or the
+    //coprocess would never see end of input
+    int in = fcntl(toChild[1], F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+    int out = fcntl(fromChild[0], F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+    close(toChild[1]);
+    close(fromChild[0]);
+
+    sigset_t tmpSa;
+    sigfillset( &tmpSa);
+    sigdelset(&tmpSa,SIGINT);
+    sigdelset(&tmpSa,SIGTSTP);
+    sigprocmask(SIG_SETMASK, &tmpSa, NULL);
+    //Start blocking signals
+
+    fflush(stdout);//or the child could flush the shell's pending output into the pipe
+    pid_t pid = fork();
+    if(!pid)
+    {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(fromChild[1]);
+        limits_apply();
+
+        checkWkdir(cmd.execArgs[2]);
+        if(execvp(cmd.execArgs[2], &cmd.execArgs[2]) < 0)
+        {
+            fprintf(stderr, "Error execing %s. Error# %d\n", cmd.execArgs[2], errno);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    close(toChild[0]);
+    close(fromChild[1]);
+
+    struct test_struct * job = pid > 0 ? add_to_list(pid, cmd.execArgs[2]) : NULL;
+    if(job != NULL)
+    {
+        snprintf(job->job_coproc, sizeof(job->job_coproc), "%s", cmd.execArgs[1]);
+        job->job_in = in;
+        job->job_out = fdopen(out, "r");
+        printf("[%d] is running\n", pid);
+    }
+    else
+    {
+        close(in);
+        close(out);
+    }
+
+    sigfillset( &tmpSa);
+    sigdelset(&tmpSa,SIGINT);
+    sigdelset(&tmpSa,SIGTSTP);
+    sigdelset(&tmpSa, SIGCHLD);
+    sigprocmask(SIG_SETMASK, &tmpSa, NULL);
+    //Stop blocking signals
+}
+
+void send_line(command_t cmd)
+{
+    if(cmd.execArgs[1] == NULL)
+    {
+        printf("Usage: send NAME text\n");
+        return;
+    }
+
+    //keep catchChild from closing the pipes while they are in use
+    sigset_t chld, old;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &old);
+
+    struct test_struct * job = search_by_coproc(cmd.execArgs[1]);
+    if(job == NULL || job->job_in < 0)
+        printf("Error: no coproc named %s\n", cmd.execArgs[1]);
+    else
+    {
+        //send everything after the name, like echo
+        size_t len;
+        char * text = afterWords(&cmd, 2, &len);
+
+        char line[MAX_COMMAND_LENGTH + 1];
+        memcpy(line, text, len);
+        line[len++] = '\n';
+
+        for(size_t done = 0; done < len; )
+        {
+            ssize_t n = write(job->job_in, line + done, len - done);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+            {
+                fprintf(stderr, "Cannot write to coproc %s. ERROR# %d\n", cmd.execArgs[1], errno);
+                break;
+            }
+            done += n;
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+void recv_line(command_t cmd)
+{
+    if(cmd.execArgs[1] == NULL)
+    {
+        printf("Usage: recv NAME\n");
+        return;
+    }
+
+    sigset_t chld, old;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &old);
+
+    struct test_struct * job = search_by_coproc(cmd.execArgs[1]);
+    char * line = NULL;
+    size_t cap = 0;
+
+    if(job == NULL || job->job_out == NULL)
+        printf("Error: no coproc named %s\n", cmd.execArgs[1]);
+    else if(getline(&line, &cap, job->job_out) < 0)
+    {
+        printf("Error: coproc %s closed its output\n", cmd.execArgs[1]);
+        closeCoproc(job);
+    }
+    else
+        fputs(line, stdout);
+
+    free(line);
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+void memo(command_t cmd)
+{
+    char * envVars[MAX_PATH_LENGTH];
+    char * deps[MAX_PATH_LENGTH];
+    int numEnv = 0, numDeps = 0;
+    int i = 1;
+
+    for( ; cmd.execArgs[i] != NULL && cmd.execArgs[i][0] == '-'; i += 2)
+    {
+        if(cmd.execArgs[i+1] == NULL)
+            break;
+        else if(!strcmp(cmd.execArgs[i], "-e"))
+            envVars[numEnv++] = cmd.execArgs[i+1];
+        else if(!strcmp(cmd.execArgs[i], "-d"))
+            deps[numDeps++] = cmd.execArgs[i+1];
+        else
+            break;
+    }
+    envVars[numEnv] = NULL;
+    deps[numDeps] = NULL;
+
+    if(cmd.execArgs[i] == NULL || cmd.execArgs[i][0] == '-')
+    {
+        printf("Usage: memo [-e VAR]... [-d FILE]... command [args]\n");
+        return;
+    }
+    if(cmd.execBg || strchr(cmd.cmdstr, '|') != NULL)
+    {
+        printf("Error: memo only runs single foreground commands\n");
+        return;
+    }
+
+    //the command without the memo prefix; runCommand already pointed
+    //stdout and stderr at its redirections
+    command_t inner = cmd;
+    for(int j = i; j <= cmd.execNumArgs; j++)
+        inner.execArgs[j-i] = cmd.execArgs[j];
+    inner.execNumArgs = cmd.execNumArgs - i;
+    strcpy(inner.outputFile, "");
+    strcpy(inner.errorFile, "");
+    inner.outputFd = -1;
+    inner.errorFd = -1;
+
+    char key[MEMO_KEY_SIZE];
+    memo_entry_t entry;
+    memo_capture_t cap;
+
+    memo_key(inner.execArgs, envVars, deps, inner.inputFile, key);
+
+    if(!memo_lookup(key, &entry))
+    {
+        if(!memo_capture_begin(&cap))
+        {
+            exec_cmd(inner);//no usable cache, so just run it
+            return;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        int savedOut = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+        int savedErr = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+        dup2(cap.outFd, STDOUT_FILENO);
+        dup2(cap.errFd, STDERR_FILENO);
+
+        //keep catchChild from reaping the command before exec_cmd gets its status
+        sigset_t chld;
+        sigemptyset(&chld);
+        sigaddset(&chld, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &chld, NULL);
+
+        bool ran = exec_cmd(inner) == 0;
+
+        fflush(stdout);
+        fflush(stderr);
+        dup2(savedOut, STDOUT_FILENO);
+        dup2(savedErr, STDERR_FILENO);
+        close(savedOut);
+        close(savedErr);
+
+        //only normal exits are worth repeating
+        if(!memo_capture_end(&cap, key, status, ran && WIFEXITED(status), &entry))
+        {
+            fprintf(stderr, "Error: memo could not save the output of %s\n", inner.execArgs[0]);
+            return;
+        }
+    }
+
+    fflush(stdout);
+    memo_replay(&entry, STDOUT_FILENO, STDERR_FILENO);
+    status = entry.status;
 }
 
 void set(command_t cmd)
@@ -419,7 +992,10 @@ void set(command_t cmd)
     if( !strcmp(temp, "PATH") )
     {
         if(setenv("PATH", strtok(NULL, " "), 1) == 0)
+        {
             printf("PATH set to %s\n", getenv("PATH"));
+            complete_invalidate();//rescan PATH for tab completion
+        }
     }
     else if( !strcmp(temp, "HOME") )
     {
@@ -432,9 +1008,55 @@ void set(command_t cmd)
     }	
 }
 
+void ulimit(command_t cmd)
+{
+    if(cmd.execArgs[1] == NULL || !strcmp(cmd.execArgs[1], "-a"))
+    {
+        limits_print(stdout);
+        return;
+    }
+
+    for(int i = 1; cmd.execArgs[i] != NULL; i += 2)
+    {
+        char * flag = cmd.execArgs[i];
+
+        if(flag[0] != '-' || flag[1] == '\0' || cmd.execArgs[i+1] == NULL ||
+           !limits_set(flag[1], cmd.execArgs[i+1]))
+        {
+            printf("Usage: ulimit [-a] [-t seconds] [-v kbytes] [-n files]\n");
+            return;
+        }
+    }
+}
+
+void cgroup(command_t cmd)
+{
+    char quota[64];
+
+    if(cmd.execArgs[1] == NULL)
+        cgroup_print(stdout);
+    else if(!strcmp(cmd.execArgs[1], "off"))
+        cgroup_disable();
+    else if(!strcmp(cmd.execArgs[1], "cpu") && cmd.execArgs[2] != NULL)
+    {
+        //cpu.max takes "<quota> <period>"
+        snprintf(quota, sizeof(quota), "%s %s", cmd.execArgs[2],
+                 cmd.execArgs[3] != NULL ? cmd.execArgs[3] : "100000");
+        cgroup_configure(quota, NULL);
+    }
+    else if(!strcmp(cmd.execArgs[1], "mem") && cmd.execArgs[2] != NULL)
+        cgroup_configure(NULL, cmd.execArgs[2]);
+    else
+        printf("Usage: cgroup [off | cpu <quota|max> [period] | mem <bytes|max>]\n");
+}
+
 void echo(command_t cmd)
 {
-    if( !strcmp(cmd.execArgs[1], "$PATH") )
+    if( cmd.execArgs[1] == NULL )
+    {
+        printf("\n");
+    }
+    else if( !strcmp(cmd.execArgs[1], "$PATH") )
     {
         printf("%s\n", getenv("PATH"));
     }
@@ -448,9 +1070,11 @@ void echo(command_t cmd)
     }
     else
     {
-        printf("%s\n", cmd.cmdstr+5);
-        //echo everything after the word echo
+        //echo the words after echo as they were expanded, like /bin/echo gets them
         //& at the end of the string and < or > must be enclosed in parenthesis
+        for(int i = 1; cmd.execArgs[i] != NULL; i++)
+            printf(i > 1 ? " %s" : "%s", cmd.execArgs[i]);
+        printf("\n");
     }
 }
 
@@ -466,18 +1090,34 @@ void terminate()
 
 bool get_command(command_t* cmd, FILE* in) 
 {
-    if (isatty(fileno(in)))
-        printf( "meh:~%s$ ", getenv("WKDIR") );
+    bool interactive = isatty(fileno(in)) && in == stdin;
+    bool read;
 
     //sigsetjmp( env, 1 );
 
-    if (fgets(cmd->cmdstr, MAX_COMMAND_LENGTH, in) != NULL) 
+    if (interactive)
+    {
+        char prompt[MAX_PATH_LENGTH + 16];
+        snprintf(prompt, sizeof(prompt), "meh:~%s$ ", getenv("WKDIR"));
+        read = lineedit_read(prompt, cmd->cmdstr, MAX_COMMAND_LENGTH) >= 0;
+    }
+    else
+        read = fgets(cmd->cmdstr, MAX_COMMAND_LENGTH, in) != NULL;
+
+    if (read) 
     {
         char tmpArgs [MAX_COMMAND_LENGTH][MAX_PATH_LENGTH];
 
+        glob_list_free(&globArgs);
         cmd->execBg = false;
         strcpy(cmd->inputFile,"");
         strcpy(cmd->outputFile,"");
+        strcpy(cmd->errorFile,"");
+        cmd->outputAppend = false;
+        cmd->errorAppend = false;
+        cmd->outputFd = -1;
+        cmd->errorFd = -1;
+        cmd->errorFirst = false;
 
         size_t len = strlen(cmd->cmdstr);
         char last_char = cmd->cmdstr[len - 1];
@@ -493,6 +1133,9 @@ bool get_command(command_t* cmd, FILE* in)
         else
             cmd->cmdlen = len;
 
+        if (interactive)
+            history_append(cmd->cmdstr);
+
         if (last_char == '&')
         {
             cmd->cmdstr[len - 1] = '\0';
@@ -517,6 +1160,7 @@ bool get_command(command_t* cmd, FILE* in)
 
         char tempcmd[MAX_COMMAND_LENGTH];
         strcpy(tempcmd, cmd->cmdstr);
+        cmd->argslen = strlen(cmd->cmdstr);
         char * temp;
         temp = strtok(tempcmd," ");
         strcpy(tmpArgs[i], temp);
@@ -526,26 +1170,18 @@ bool get_command(command_t* cmd, FILE* in)
 
         while(((temp = strtok(NULL," ")) != NULL) && (i<255))
         {
-            if( !strcmp(temp, "<") || !strcmp(temp, ">") )
+            if( isRedirect(temp) )
             {
-                if( !strcmp(temp, "<") )
-                {
-                    temp = strtok(NULL, " ");
-                    strcpy( cmd->inputFile, temp );
-                    temp = strtok(NULL, " ");
-                }
-
-                if( temp != NULL && !strcmp(temp, ">") )
-                {
-                    temp = strtok(NULL, " ");
-                    strcpy( cmd->outputFile, temp );
-                    temp = strtok(NULL, " ");
-                }
+                cmd->argslen = temp - tempcmd;
 
-                if( temp != NULL )
+                //redirections end the command
+                for( ; temp != NULL; temp = strtok(NULL, " ") )
                 {
-                    printf("Error: incorrect command format\n");
-                    return false;
+                    if( !isRedirect(temp) || !parseRedirect(cmd, temp) )
+                    {
+                        printf("Error: incorrect command format\n");
+                        return false;
+                    }
                 }
 
                 cmd->execArgs[i] = NULL;
@@ -556,8 +1192,7 @@ bool get_command(command_t* cmd, FILE* in)
             
             strcpy( tmpArgs[i], temp );
             
-            cmd->execArgs[i] = tmpArgs[i];
-            i++;
+            i = addArg(cmd->execArgs, i, tmpArgs[i]);
         }
 
         cmd->execArgs [i] = NULL;
@@ -566,7 +1201,10 @@ bool get_command(command_t* cmd, FILE* in)
         return true;
     }
     else
+    {
+        terminate();//end of input
         return false;
+    }
 }
 
 int pipeParse(command_t cmd, command_t * cmd_a)
@@ -637,15 +1275,14 @@ int pipeParse(command_t cmd, command_t * cmd_a)
 
         while((arg = strtok(NULL," ")) != NULL)
         {
-            if( !strcmp(arg, "<") || !strcmp(arg, ">") )
+            if( isRedirect(arg) )
             {
                 break;
             }
 
             strcpy(argStore[argIter], arg);
-            cmd_a[i].execArgs[numArgs] = argStore[argIter];
+            numArgs = addArg(cmd_a[i].execArgs, numArgs, argStore[argIter]);
             argIter++;
-            numArgs++;
         }
 
         cmd_a[i].execArgs[numArgs] = NULL;
@@ -680,6 +1317,391 @@ bool killChild(command_t cmd)
     }
 }
 
+/**
+ * Checks if name is a builtin, which runs inside the shell.
+ */
+static bool isBuiltin(const char * name)
+{
+    for(int i = 0; builtins[i] != NULL; i++)
+    {
+        if(!strcmp(name, builtins[i]))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Checks if name is a builtin that changes shell state.
+ */
+static bool isBarrier(const char * name)
+{
+    for(int i = 0; barriers[i] != NULL; i++)
+    {
+        if(!strcmp(name, barriers[i]))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Runs one parsed command. A builtin's redirections are applied to the shell
+ * itself for as long as it runs.
+ */
+static void runCommand(command_t * cmd)
+{
+    int saved[2] = {-1, -1};
+    bool redirected = isBuiltin(cmd->execArgs[0]) &&
+        (strcmp(cmd->outputFile, "") || strcmp(cmd->errorFile, "") ||
+         cmd->outputFd >= 0 || cmd->errorFd >= 0);
+
+    if(redirected)
+    {
+        int out, err;
+        if(!openRedirects(cmd, &out, &err))
+            return;
+
+        fflush(stdout);
+        fflush(stderr);
+        saved[0] = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+        saved[1] = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+        applyRedirects(cmd, out, err);
+        closeRedirects(cmd, out, err);
+    }
+
+    if (!strcmp(cmd->cmdstr, "q")||!strcmp(cmd->cmdstr, "exit")||!strcmp(cmd->cmdstr, "quit"))
+        terminate(); // Exit Quash
+    else if(!strcmp(cmd->execArgs[0], "set"))
+        set(*cmd);//set environment variables
+    else if(!strcmp(cmd->execArgs[0], "echo"))
+        echo(*cmd);//echos environment variables
+    else if(!strcmp(cmd->execArgs[0], "pwd"))
+        pwd(*cmd);//prints current working directory
+    else if(!strcmp(cmd->execArgs[0], "cd"))
+        cd(*cmd);//changes the working directory
+    else if(!strcmp(cmd->execArgs[0], "jobs"))
+        jobs();//prints out a list of currently running jobs
+    else if(!strcmp(cmd->execArgs[0], "history"))
+        history(*cmd);//prints or searches the command history
+    else if(!strcmp(cmd->execArgs[0], "ulimit"))
+        ulimit(*cmd);//sets resource limits for started commands
+    else if(!strcmp(cmd->execArgs[0], "cgroup"))
+        cgroup(*cmd);//places background jobs in limited cgroups
+    else if(!strcmp(cmd->execArgs[0], "exec"))
+        exec(*cmd);//opens or closes descriptors held by the shell
+    else if(!strcmp(cmd->execArgs[0], "memo"))
+        memo(*cmd);//runs a command through the result cache
+    else if(!strcmp(cmd->execArgs[0], "coproc"))
+        coproc(*cmd);//starts a named coprocess
+    else if(!strcmp(cmd->execArgs[0], "send"))
+        send_line(*cmd);//writes a line to a coprocess
+    else if(!strcmp(cmd->execArgs[0], "recv"))
+        recv_line(*cmd);//reads a line from a coprocess
+    else if(!strcmp(cmd->execArgs[0], "kill"))
+        killChild(*cmd);//kills specified job
+    else if (!strcmp(cmd->execArgs[0], "wait"))
+        sleep(atoi(cmd->execArgs[1]));
+    else if (strchr(cmd->cmdstr,'|')!= NULL)
+        exec_pipes(*cmd);//executes piped commands
+    else 
+        exec_cmd(*cmd);//executes normal commands
+
+    if(redirected)
+    {
+        fflush(stdout);
+        fflush(stderr);
+        dup2(saved[0], STDOUT_FILENO);
+        dup2(saved[1], STDERR_FILENO);
+        close(saved[0]);
+        close(saved[1]);
+    }
+}
+
+/**
+ * Parses one script line as get_command would read it.
+ *
+ * @return True if line holds a valid command and false otherwise
+ */
+static bool parseLine(const char * line, command_t * cmd)
+{
+    FILE * in = fmemopen((void *)line, strlen(line), "r");
+    if(in == NULL)
+        return false;
+
+    bool parsed = get_command(cmd, in);
+    fclose(in);
+    return parsed;
+}
+
+/**
+ * Adds a file to the dependency graph under its resolved directory and
+ * name, so every spelling of one file is one resource. A file in a
+ * directory that does not exist keeps the name it was given.
+ */
+static void addFile(dag_t * dag, const char * path, bool write)
+{
+    char name[MAX_PATH_LENGTH];
+    char dir[MAX_PATH_LENGTH];
+    const char * slash = strrchr(path, '/');
+
+    //relative paths are opened from quash's own directory, which cd leaves alone
+    if(slash == NULL)
+        strcpy(dir, ".");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+
+    char * real = realpath(dir, NULL);
+    if(real == NULL || snprintf(name, sizeof(name), "%s/%s", strcmp(real, "/") ? real : "",
+                                slash ? slash + 1 : path) >= (int)sizeof(name))
+        snprintf(name, sizeof(name), "%s", path);
+    free(real);
+
+    if(write)
+        dag_write(dag, name);
+    else
+        dag_read(dag, name);
+}
+
+/**
+ * Adds the script line's files to the dependency graph. Its stdout and
+ * stderr are captured separately, so only redirections count.
+ */
+static void addResources(dag_t * dag, command_t * cmd, char * deps, char * outputs)
+{
+    char fdName[16];
+
+    if(strcmp(cmd->inputFile, ""))
+        addFile(dag, cmd->inputFile, false);
+    if(strcmp(cmd->outputFile, ""))
+        addFile(dag, cmd->outputFile, true);
+    if(strcmp(cmd->errorFile, ""))
+        addFile(dag, cmd->errorFile, true);
+
+    //descriptors held open with exec are shared by every line using them
+    if(cmd->outputFd >= 0)
+    {
+        snprintf(fdName, sizeof(fdName), "&%d", cmd->outputFd);
+        dag_write(dag, fdName);
+    }
+    if(cmd->errorFd >= 0 && cmd->errorFd != 1)
+    {
+        snprintf(fdName, sizeof(fdName), "&%d", cmd->errorFd);
+        dag_write(dag, fdName);
+    }
+
+    for(char * f = strtok(deps, " \t\n"); f != NULL; f = strtok(NULL, " \t\n"))
+        addFile(dag, f, false);
+    for(char * f = strtok(outputs, " \t\n"); f != NULL; f = strtok(NULL, " \t\n"))
+        addFile(dag, f, true);
+}
+
+/**
+ * Copies a finished line's captured output to fd and removes it.
+ */
+static void emitCapture(char * path, int fd)
+{
+    char buf[65536];
+    ssize_t n;
+
+    if(path == NULL)
+        return;
+
+    int in = open(path, O_RDONLY);
+    if(in >= 0)
+    {
+        fflush(stdout);
+        fflush(stderr);
+        while((n = read(in, buf, sizeof(buf))) > 0)
+            write(fd, buf, n);
+        close(in);
+    }
+
+    unlink(path);
+    free(path);
+}
+
+/**
+ * Runs a script with up to maxJobs lines at once. Lines are ordered by the
+ * files they redirect from and to, plus "# deps: files" and
+ * "# outputs: files" annotations on the lines before them. Each line runs in
+ * a forked copy of the shell with its stdout and stderr captured to
+ * separate files, which are copied to quash's stdout and stderr in script
+ * order.
+ *
+ * @return the exit status for quash
+ */
+static int runParallel(const char * script, int maxJobs)
+{
+    FILE * in = fopen(script, "r");
+    if(in == NULL)
+    {
+        fprintf(stderr, "Cannot open %s. ERROR# %d\n", script, errno);
+        return EXIT_FAILURE;
+    }
+
+    char line[MAX_COMMAND_LENGTH];
+    char deps[MAX_COMMAND_LENGTH] = "";
+    char outputs[MAX_COMMAND_LENGTH] = "";
+    char ** lines = NULL;
+    int numLines = 0;
+    dag_t * dag = dag_create();
+    command_t cmd;
+
+    //parse errors are printed when the line runs, in order
+    fflush(stdout);
+    int savedOut = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char * p = line;
+        while(*p == ' ' || *p == '\t')
+            p++;
+
+        if(*p == '#')
+        {
+            char * note = p + 1;
+            while(*note == ' ')
+                note++;
+
+            char * list = !strncmp(note, "deps:", 5) ? deps : !strncmp(note, "outputs:", 8) ? outputs : NULL;
+            if(list != NULL)
+            {
+                size_t used = strlen(list);
+                snprintf(list + used, MAX_COMMAND_LENGTH - used, " %s", strchr(note, ':') + 1);
+            }
+            continue;
+        }
+        if(strspn(p, " \t\r\n") == strlen(p))
+            continue;
+
+        bool valid = parseLine(p, &cmd);
+        dag_add_node(dag, valid && isBarrier(cmd.execArgs[0]));
+        if(valid)
+            addResources(dag, &cmd, deps, outputs);
+        deps[0] = '\0';
+        outputs[0] = '\0';
+
+        lines = realloc(lines, (numLines + 1) * sizeof(char *));
+        lines[numLines++] = strdup(p);
+    }
+    fclose(in);
+
+    fflush(stdout);
+    dup2(savedOut, STDOUT_FILENO);
+    close(savedOut);
+
+    //workers are reaped here, not by catchChild
+    struct sigaction dfl;
+    memset(&dfl, 0, sizeof(dfl));
+    dfl.sa_handler = SIG_DFL;
+    sigaction(SIGCHLD, &dfl, NULL);
+
+    char ** captures = calloc(numLines, sizeof(char *));
+    char ** errCaptures = calloc(numLines, sizeof(char *));
+    bool * finished = calloc(numLines, sizeof(bool));
+    pid_t * pids = calloc(numLines, sizeof(pid_t));
+    int running = 0, emitted = 0;
+
+    while(emitted < numLines && is_running())
+    {
+        int node;
+        while(running < maxJobs && is_running() && (node = dag_next_ready(dag)) >= 0)
+        {
+            if(dag_is_barrier(dag, node))
+            {
+                //everything before it is done and printed, nothing after it has started
+                if(parseLine(lines[node], &cmd))
+                    runCommand(&cmd);
+                fflush(stdout);
+            }
+            else
+            {
+                char path[] = "/tmp/quash-par.XXXXXX";
+                char errPath[] = "/tmp/quash-par.XXXXXX";
+                int fd = mkstemp(path);
+                int errFd = fd >= 0 ? mkstemp(errPath) : -1;
+                if(errFd >= 0)
+                {
+                    fflush(stdout);
+                    fflush(stderr);
+                    pids[node] = fork();
+                    if(pids[node] == 0)
+                    {
+                        dup2(fd, STDOUT_FILENO);
+                        dup2(errFd, STDERR_FILENO);
+                        close(fd);
+                        close(errFd);
+                        if(parseLine(lines[node], &cmd))
+                            runCommand(&cmd);
+                        fflush(stdout);
+                        fflush(stderr);
+                        _exit(EXIT_SUCCESS);
+                    }
+                    close(fd);
+                    close(errFd);
+
+                    captures[node] = strdup(path);
+                    errCaptures[node] = strdup(errPath);
+                    running++;
+                    continue;
+                }
+                if(fd >= 0)
+                {
+                    close(fd);
+                    unlink(path);
+                }
+                fprintf(stderr, "Cannot capture output of line %d. ERROR# %d\n", node + 1, errno);
+            }
+
+            finished[node] = true;
+            dag_done(dag, node);
+            for( ; emitted < numLines && finished[emitted]; emitted++)
+            {
+                emitCapture(captures[emitted], STDOUT_FILENO);
+                emitCapture(errCaptures[emitted], STDERR_FILENO);
+            }
+        }
+
+        if(running == 0)
+            break;
+
+        int workerStatus;
+        pid_t pid = waitpid(-1, &workerStatus, 0);
+        if(pid < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        for(node = 0; node < numLines && (pids[node] != pid || finished[node]); node++);
+        if(node == numLines)
+            continue;//a background job started by a barrier
+
+        running--;
+        finished[node] = true;
+        dag_done(dag, node);
+        for( ; emitted < numLines && finished[emitted]; emitted++)
+        {
+            emitCapture(captures[emitted], STDOUT_FILENO);
+            emitCapture(errCaptures[emitted], STDERR_FILENO);
+        }
+    }
+
+    for(int i = 0; i < numLines; i++)
+        free(lines[i]);
+    free(lines);
+    free(captures);
+    free(errCaptures);
+    free(finished);
+    free(pids);
+    dag_destroy(dag);
+
+    return EXIT_SUCCESS;
+}
+
 /**
  * Quash entry point
  *
@@ -689,6 +1711,21 @@ bool killChild(command_t cmd)
  */
 int main(int argc, char** argv) { 
     command_t cmd; //< Command holder argument
+    int parallel = 0; //< lines run at once with -P, 0 to read commands interactively
+    int opt;
+
+    while((opt = getopt(argc, argv, "P:")) != -1)
+    {
+        if(opt == 'P' && atoi(optarg) > 0)
+            parallel = atoi(optarg);
+        else
+            parallel = -1;
+    }
+    if(parallel < 0 || (parallel > 0 && optind >= argc))
+    {
+        fprintf(stderr, "Usage: %s [-P jobs script]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
       
     start();
     struct sigaction NULL_sa;
@@ -698,12 +1735,25 @@ int main(int argc, char** argv) {
     sigdelset(&mask_set,SIGINT);
     sigdelset(&mask_set,SIGTSTP);
     sa.sa_handler = catchChild;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;//left uninitialized this could hold SA_NOCLDWAIT
     sigprocmask(SIG_SETMASK, &mask_set, NULL);
     //TODO: this is involved withe the error 10 problem. Removing it remedies the issue for now but breaks other things.
     sigaction(SIGCHLD, &sa,NULL);//child termination calls catchChild;
 
     setenv( "WKDIR", getenv("HOME"), 1 );
 
+    if(parallel > 0)
+        return runParallel(argv[optind], parallel);
+
+    char histFile[MAX_PATH_LENGTH];
+    if (getenv("HISTFILE") != NULL)
+        snprintf(histFile, MAX_PATH_LENGTH, "%s", getenv("HISTFILE"));
+    else
+        snprintf(histFile, MAX_PATH_LENGTH, "%s/.quash_history", getenv("HOME"));
+    history_open(histFile);
+    complete_init(builtins);
+
     puts("hOi! Welcome to Quash!");
 
     // Main execution loop
@@ -713,29 +1763,13 @@ int main(int argc, char** argv) {
         // this while loop. It is just an example.
 
         // The commands should be parsed, then executed.
-        if( !get_command(&cmd, stdin) );
-        else if (!strcmp(cmd.cmdstr, "q")||!strcmp(cmd.cmdstr, "exit")||!strcmp(cmd.cmdstr, "quit"))
-            terminate(); // Exit Quash
-        else if(!strcmp(cmd.execArgs[0], "set"))
-            set(cmd);//set environment variables
-        else if(!strcmp(cmd.execArgs[0], "echo"))
-            echo(cmd);//echos environment variables
-        else if(!strcmp(cmd.execArgs[0], "pwd"))
-            pwd(cmd);//prints current working directory
-        else if(!strcmp(cmd.execArgs[0], "cd"))
-            cd(cmd);//changes the working directory
-        else if(!strcmp(cmd.execArgs[0], "jobs"))
-            jobs();//prints out a list of currently running jobs
-        else if(!strcmp(cmd.execArgs[0], "kill"))
-            killChild(cmd);//kills specified job
-        else if (!strcmp(cmd.execArgs[0], "wait"))
-            sleep(atoi(cmd.execArgs[1]));
-        else if (strchr(cmd.cmdstr,'|')!= NULL)
-            exec_pipes(cmd);//executes piped commands
-        else 
-            exec_cmd(cmd);//executes normal commands
+        if( get_command(&cmd, stdin) )
+            runCommand(&cmd);
     }
 
+    history_close();
+    redirect_cache_clear();
+
     return EXIT_SUCCESS;
 }
 
@@ -33,6 +33,13 @@ typedef struct command_t {
     char * execArgs[MAX_PATH_LENGTH];
     char inputFile[MAX_PATH_LENGTH];
     char outputFile[MAX_PATH_LENGTH];
+    bool outputAppend;//true for >> and &>>
+    int outputFd;//descriptor named by >&N, -1 if none
+    char errorFile[MAX_PATH_LENGTH];
+    bool errorAppend;//true for 2>>
+    int errorFd;//descriptor named by 2>&N (1 for 2>&1 and &>), -1 if none
+    bool errorFirst;//2>&N came before the stdout redirection, so it takes the old stdout
+    size_t argslen;//length of cmdstr before the first redirection
     //FILE * inputFile;
     //FILE * outputFile;
 } command_t;
@@ -50,11 +57,6 @@ void catchChild();
  * @return True if Quash should accept more input and false otherwise
  */
 bool is_running();
-/**
- * Outputs STDIO to a file.
- */
-void execToFile(char ** execArgs, char * outputFile);
-
 /**
  * checks to see if the exec exists in the wkdir
  */
@@ -75,6 +77,49 @@ void pwd();
  */
 void cd(command_t cmd);
 
+/**
+ * Prints the command history, the last N entries of it, or with -s the
+ * entries containing a string.
+ */
+void history(command_t cmd);
+
+/**
+ * Sets or prints the resource limits applied to started commands.
+ */
+void ulimit(command_t cmd);
+
+/**
+ * Configures or prints cgroup placement of background jobs.
+ */
+void cgroup(command_t cmd);
+
+/**
+ * Opens, duplicates or closes descriptors held by the shell
+ */
+void exec(command_t cmd);
+
+/**
+ * Starts a named coprocess whose stdin and stdout stay connected to the
+ * shell
+ */
+void coproc(command_t cmd);
+
+/**
+ * Writes a line to a coprocess's stdin
+ */
+void send_line(command_t cmd);
+
+/**
+ * Reads a line from a coprocess's stdout and prints it
+ */
+void recv_line(command_t cmd);
+
+/**
+ * Runs a command through the result cache, replaying its output and exit
+ * status if nothing it depends on has changed
+ */
+void memo(command_t cmd);
+
 /**
  * Tries to execute command
  *
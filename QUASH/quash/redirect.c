@@ -0,0 +1,231 @@
+/**
+ * @file redirect.c
+ *
+ * Cached descriptors are opened with O_APPEND and moved above
+ * #REDIRECT_MAX_USER_FD with close-on-exec set, so children only see them
+ * through dup2(). Because every write goes to the end of the file, `>` on a
+ * cached file is a plain ftruncate(). An entry is trusted only while the
+ * path still names the same inode, which catches files that were removed,
+ * replaced, or are reached through a relative path from another directory.
+ */
+
+/**************************************************************************
+ * Included Files
+ **************************************************************************/
+#include "redirect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**************************************************************************
+ * Private Variables
+ **************************************************************************/
+#define CACHE_SIZE (16)
+
+/**
+ * One open redirection target.
+ */
+typedef struct cache_entry_t {
+    char * path;       ///< path as written in the command, NULL if unused
+    dev_t dev;
+    ino_t ino;
+    int fd;
+    unsigned lastUse;  ///< for evicting the least recently used entry
+} cache_entry_t;
+
+static cache_entry_t cache[CACHE_SIZE];
+static unsigned useClock = 0;
+
+/**************************************************************************
+ * Private Functions
+ **************************************************************************/
+static void entry_close(cache_entry_t * e)
+{
+    if (e->path == NULL)
+        return;
+
+    close(e->fd);
+    free(e->path);
+    e->path = NULL;
+}
+
+static cache_entry_t * cache_find(const char * path)
+{
+    for (int i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].path != NULL && !strcmp(cache[i].path, path))
+            return &cache[i];
+
+    return NULL;
+}
+
+static cache_entry_t * cache_slot()
+{
+    cache_entry_t * oldest = &cache[0];
+
+    for (int i = 0; i < CACHE_SIZE; i++)
+    {
+        if (cache[i].path == NULL)
+            return &cache[i];
+        if (cache[i].lastUse < oldest->lastUse)
+            oldest = &cache[i];
+    }
+
+    entry_close(oldest);
+    return oldest;
+}
+
+/**
+ * Parses the descriptor at the start of spec.
+ *
+ * @return the descriptor or -1 if it is missing or out of range
+ */
+static int parse_fd(const char * spec, const char ** rest)
+{
+    char * end;
+    long fd = strtol(spec, &end, 10);
+
+    *rest = end;
+    if (end == spec || fd < 0 || fd > REDIRECT_MAX_USER_FD)
+        return -1;
+
+    return (int)fd;
+}
+
+/**************************************************************************
+ * Public Functions
+ **************************************************************************/
+int redirect_open(const char * path, bool append)
+{
+    struct stat st;
+    cache_entry_t * e = cache_find(path);
+
+    if (e != NULL)
+    {
+        if (stat(path, &st) == 0 && st.st_dev == e->dev && st.st_ino == e->ino)
+        {
+            if (!append && S_ISREG(st.st_mode) && ftruncate(e->fd, 0) != 0)
+                return -1;
+
+            e->lastUse = ++useClock;
+            return e->fd;
+        }
+        entry_close(e);
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (append ? 0 : O_TRUNC);
+    int fd = open(path, flags, 0666);
+    if (fd < 0)
+        return -1;
+
+    // Pipes and sockets would see a reader wait for an EOF that never comes
+    if (fstat(fd, &st) != 0 || !(S_ISREG(st.st_mode) || S_ISCHR(st.st_mode)))
+        return fd;
+
+    int high = fcntl(fd, F_DUPFD_CLOEXEC, REDIRECT_MAX_USER_FD + 1);
+    if (high < 0)
+        return fd;
+    close(fd);
+
+    e = cache_slot();
+    e->path = strdup(path);
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->fd = high;
+    e->lastUse = ++useClock;
+
+    return high;
+}
+
+void redirect_release(int fd)
+{
+    if (fd < 0)
+        return;
+
+    for (int i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].path != NULL && cache[i].fd == fd)
+            return;
+
+    close(fd);
+}
+
+void redirect_cache_clear()
+{
+    for (int i = 0; i < CACHE_SIZE; i++)
+        entry_close(&cache[i]);
+}
+
+bool redirect_persist(const char * spec, const char * path)
+{
+    const char * op;
+    int fd = parse_fd(spec, &op);
+
+    if (fd < REDIRECT_MIN_USER_FD)
+    {
+        printf("Error: exec can only use descriptors %d to %d\n",
+               REDIRECT_MIN_USER_FD, REDIRECT_MAX_USER_FD);
+        return false;
+    }
+
+    if (!strcmp(op, ">&-") || !strcmp(op, "<&-"))
+    {
+        close(fd);
+        return true;
+    }
+
+    if (!strncmp(op, ">&", 2) || !strncmp(op, "<&", 2))
+    {
+        const char * end;
+        int from = parse_fd(op + 2, &end);
+
+        if (from < 0 || *end != '\0' || fcntl(from, F_GETFD) < 0)
+        {
+            printf("Error: %s is not an open descriptor\n", op + 2);
+            return false;
+        }
+        if (from != fd && dup2(from, fd) < 0)
+        {
+            fprintf(stderr, "Cannot duplicate descriptor %d. ERROR# %d\n", from, errno);
+            return false;
+        }
+        return true;
+    }
+
+    int flags;
+    if (!strcmp(op, ">"))
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    else if (!strcmp(op, ">>"))
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    else if (!strcmp(op, "<"))
+        flags = O_RDONLY;
+    else
+    {
+        printf("Usage: exec N> file | N>> file | N< file | N>&M | N>&-\n");
+        return false;
+    }
+
+    if (path == NULL)
+    {
+        printf("Error: exec %s needs a file\n", spec);
+        return false;
+    }
+
+    int opened = open(path, flags, 0666);
+    if (opened < 0)
+    {
+        fprintf(stderr, "Cannot open %s. ERROR# %d\n", path, errno);
+        return false;
+    }
+
+    // Left without close-on-exec so every command started later inherits it
+    if (opened != fd)
+    {
+        dup2(opened, fd);
+        close(opened);
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file redirect.h
+ *
+ * Output redirection targets opened through a descriptor cache, and
+ * descriptors held open by the shell with `exec N> file`.
+ */
+
+#ifndef REDIRECT_H
+#define REDIRECT_H
+
+#include <stdbool.h>
+
+/**
+ * Lowest descriptor a script may hold open with `exec N> file`.
+ */
+#define REDIRECT_MIN_USER_FD (3)
+
+/**
+ * Highest descriptor a script may hold open with `exec N> file`. The cache
+ * keeps its own descriptors above it.
+ */
+#define REDIRECT_MAX_USER_FD (9)
+
+/**
+ * Opens path for writing. Regular files and devices stay open in the cache
+ * so the next command writing to the same file reuses the descriptor; a
+ * truncating open of a cached file just truncates it.
+ *
+ * @param path - the file to write
+ * @param append - true for `>>`, false for `>`
+ * @return a descriptor to dup2() in the child, or -1 with errno set
+ */
+int redirect_open(const char * path, bool append);
+
+/**
+ * Gives back a descriptor from redirect_open() once the child is started.
+ * Only descriptors the cache did not keep are closed.
+ */
+void redirect_release(int fd);
+
+/**
+ * Closes every cached descriptor.
+ */
+void redirect_cache_clear();
+
+/**
+ * Opens, duplicates or closes a descriptor held by the shell, as in
+ * `exec 3> file`, `exec 3>> file`, `exec 3< file`, `exec 3>&1` or
+ * `exec 3>&-`.
+ *
+ * @param spec - the descriptor and operator, e.g. "3>" or "3>&-"
+ * @param path - the file for operators that take one, otherwise NULL
+ * @return True on success and false with a message printed otherwise
+ */
+bool redirect_persist(const char * spec, const char * path);
+
+#endif // REDIRECT_H
@@ -1,11 +1,319 @@
 /** @file libpriqueue.c
+
+  The queue is a binary min-heap kept in a growable array, so offer and poll
+  are O(log n). Elements the comparer finds equal leave in the order they
+  were offered in. The comparer is always asked about the newer of two
+  elements against the older one, the way the sorted list asked it, so a
+  comparer that never returns 0, like one that always returns 1 for first
+  come first served, orders the heap exactly as it ordered the list.
+
+  Each element also gets a handle when it is offered. q->pos maps handles
+  to heap slots and is kept current as nodes move, so an element can be
+  found, removed or re-sifted in O(log n) without searching for it.
+
+  Walking the queue in order (priqueue_at and the iterators) uses a sorted
+  copy of the heap. Once it has been built, offers and removals keep it
+  up to date with a binary search and a memmove, so walking the queue
+  after every change costs O(n) rather than a fresh sort each time. The
+  copy is dropped again if it goes unread for a while, so a queue that is
+  only walked once in a while is not slowed down by keeping it.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "libpriqueue.h"
 
+/** Changes the sorted copy absorbs without being read before it is dropped */
+#define SORTED_MAX_UNREAD 32
+
+/**
+  Checks whether node a belongs ahead of node b.
+
+  The newer of the two is always passed to the comparer first, as the list
+  passed it, and a tie goes to the older one.
+ */
+static int node_before(priqueue_t *q, const priqueue_node *a, const priqueue_node *b)
+{
+  if( a->seq > b->seq )
+  {
+    return (*q->comparer)( a->data, b->data ) < 0;
+  }
+  return (*q->comparer)( b->data, a->data ) >= 0;
+}
+
+/**
+  Stores node in heap slot i, recording the slot for its handle when pos
+  is given.
+ */
+static void place(priqueue_node *heap, int *pos, int i, priqueue_node node)
+{
+  heap[i] = node;
+  if( pos != NULL )
+  {
+    pos[node.handle] = i;
+  }
+}
+
+static int sift_up(priqueue_t *q, priqueue_node *heap, int *pos, int i)
+{
+  priqueue_node node = heap[i];
+
+  while( i > 0 )
+  {
+    int parent = (i - 1) / 2;
+    if( !node_before( q, &node, &heap[parent] ) )
+    {
+      break;
+    }
+    place( heap, pos, i, heap[parent] );
+    i = parent;
+  }
+  place( heap, pos, i, node );
+
+  return i;
+}
+
+static void sift_down(priqueue_t *q, priqueue_node *heap, int *pos, int size, int i)
+{
+  priqueue_node node = heap[i];
+
+  while( 2 * i + 1 < size )
+  {
+    int child = 2 * i + 1;
+    if( child + 1 < size && node_before( q, &heap[child + 1], &heap[child] ) )
+    {
+      child++;
+    }
+    if( !node_before( q, &heap[child], &node ) )
+    {
+      break;
+    }
+    place( heap, pos, i, heap[child] );
+    i = child;
+  }
+  place( heap, pos, i, node );
+}
+
+/**
+  Moves the node at heap position i up or down to where it belongs.
+ */
+static void resift(priqueue_t *q, int i)
+{
+  if( sift_up( q, q->heap, q->pos, i ) == i )
+  {
+    sift_down( q, q->heap, q->pos, q->size, i );
+  }
+}
+
+/**
+  Gets the heap position of a handle, or -1 if the handle is not in use.
+ */
+static int handle_pos(priqueue_t *q, int handle)
+{
+  if( handle < 0 || handle >= q->next_handle )
+  {
+    return -1;
+  }
+  return q->pos[handle];
+}
+
+static void release_handle(priqueue_t *q, int handle)
+{
+  q->pos[handle] = -1;
+  q->free_handles[q->num_free++] = handle;
+}
+
+/**
+  Finds where node goes in the first count entries of q->sorted.
+ */
+static int sorted_find(priqueue_t *q, const priqueue_node *node, int count)
+{
+  int lo = 0, hi = count;
+
+  while( lo < hi )
+  {
+    int mid = lo + (hi - lo) / 2;
+    if( q->sorted[mid].seq == node->seq )
+    {
+      return mid;
+    }
+    if( node_before( q, &q->sorted[mid], node ) )
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+  Checks whether the sorted copy should be kept up to date through one
+  more change, dropping it if it has not been read for too long.
+ */
+static int sorted_keep(priqueue_t *q)
+{
+  if( q->sorted_valid && ++q->sorted_unread > SORTED_MAX_UNREAD )
+  {
+    q->sorted_valid = 0;
+  }
+  return q->sorted_valid;
+}
+
+/**
+  Adds the node just offered to the sorted copy, which holds the other
+  q->size - 1 nodes.
+ */
+static void sorted_insert(priqueue_t *q, priqueue_node node)
+{
+  if( !sorted_keep( q ) )
+  {
+    return;
+  }
+
+  int i = sorted_find( q, &node, q->size - 1 );
+  memmove( &q->sorted[i + 1], &q->sorted[i], (q->size - 1 - i) * sizeof(priqueue_node) );
+  q->sorted[i] = node;
+}
+
+/**
+  Takes a node that is leaving the queue out of the sorted copy, before
+  q->size is decremented.
+ */
+static void sorted_delete(priqueue_t *q, priqueue_node node)
+{
+  if( !sorted_keep( q ) )
+  {
+    return;
+  }
+
+  int i = sorted_find( q, &node, q->size );
+  memmove( &q->sorted[i], &q->sorted[i + 1], (q->size - 1 - i) * sizeof(priqueue_node) );
+}
+
+/**
+  Removes the node at heap position i and restores the heap.
+ */
+static void *remove_node(priqueue_t *q, int i)
+{
+  priqueue_node node = q->heap[i];
+
+  sorted_delete( q, node );
+  release_handle( q, node.handle );
+  q->size--;
+  if( i < q->size )
+  {
+    place( q->heap, q->pos, i, q->heap[q->size] );
+    resift( q, i );
+  }
+
+  return node.data;
+}
+
+/**
+  Makes room for at least count nodes.
+ */
+static void reserve(priqueue_t *q, int count)
+{
+  if( count <= q->capacity )
+  {
+    return;
+  }
+
+  int capacity = q->capacity ? q->capacity : 16;
+  while( capacity < count )
+  {
+    capacity *= 2;
+  }
+
+  q->capacity = capacity;
+  q->heap = realloc( q->heap, q->capacity * sizeof(priqueue_node) );
+  q->sorted = realloc( q->sorted, q->capacity * sizeof(priqueue_node) );
+  q->pos = realloc( q->pos, q->capacity * sizeof(int) );
+  q->free_handles = realloc( q->free_handles, q->capacity * sizeof(int) );
+}
+
+/**
+  Puts a node at the end of the heap array without restoring the heap.
+
+  @return the node's handle
+ */
+static int append_node(priqueue_t *q, void *data, unsigned long seq)
+{
+  //Handles are reused once freed, so they never outnumber the capacity
+  int handle = q->num_free > 0 ? q->free_handles[--q->num_free] : q->next_handle++;
+
+  q->heap[q->size].data = data;
+  q->heap[q->size].seq = seq;
+  q->heap[q->size].handle = handle;
+  q->pos[handle] = q->size;
+  q->size++;
+
+  return handle;
+}
+
+/**
+  Restores the heap after nodes were appended from old_size on. Sifting
+  each one up costs O(k log n) for k new nodes and rebuilding costs O(n),
+  so whichever is cheaper is used.
+ */
+static void settle_appended(priqueue_t *q, int old_size)
+{
+  int added = q->size - old_size;
+  int log_size = 1;
+  int i;
+
+  while( (1 << log_size) < q->size )
+  {
+    log_size++;
+  }
+
+  if( (long)added * log_size < q->size )
+  {
+    for( i = old_size; i < q->size; i++ )
+    {
+      sift_up( q, q->heap, q->pos, i );
+    }
+    q->sorted_valid = 0;
+  }
+  else
+  {
+    priqueue_reindex( q );
+  }
+}
+
+/**
+  Fills q->sorted with the queue in priority order, if it is out of date,
+  for a caller about to read it.
+ */
+static void sort_nodes(priqueue_t *q)
+{
+  q->sorted_unread = 0;
+  if( q->sorted_valid )
+  {
+    return;
+  }
+
+  priqueue_node *work = malloc( q->size * sizeof(priqueue_node) + 1 );
+  int size = q->size;
+  int i;
+
+  memcpy( work, q->heap, q->size * sizeof(priqueue_node) );
+  for( i = 0; i < q->size; i++ )
+  {
+    q->sorted[i] = work[0];
+    work[0] = work[--size];
+    sift_down( q, work, NULL, size, 0 );
+  }
+
+  free( work );
+  q->sorted_valid = 1;
+}
+
 /**
   Initializes the priqueue_t data structure.
   
@@ -21,10 +329,22 @@ void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
   if(NULL == q)
   {
     printf("\n Node creation failed \n");
-    
+    return;
   }
 
-  q->head = NULL;
+  q->heap = NULL;
+  q->size = 0;
+  q->capacity = 0;
+  q->next_seq = 0;
+
+  q->pos = NULL;
+  q->free_handles = NULL;
+  q->num_free = 0;
+  q->next_handle = 0;
+
+  q->sorted = NULL;
+  q->sorted_valid = 0;
+  q->sorted_unread = 0;
 
   q->comparer = comparer;
 }
@@ -34,57 +354,108 @@ void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
 
   @param q a pointer to an instance of the priqueue_t data structure
   @param ptr a pointer to the data to be inserted into the priority queue
-  @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
+  @return a handle for the element, which stays valid until the element leaves the queue. It can then be handed out again.
  */
 int priqueue_offer(priqueue_t *q, void *ptr)
 {
-  struct priqueue_node *node = (struct priqueue_node*)malloc(sizeof(struct priqueue_node));
+  reserve( q, q->size + 1 );
+
+  int handle = append_node( q, ptr, q->next_seq++ );
+
+  sorted_insert( q, q->heap[q->size - 1] );
+  sift_up( q, q->heap, q->pos, q->size - 1 );
+
+  return handle;
+}
 
-  node->next = NULL;
-  node->data = ptr;
+/**
+  Inserts n elements at once, in O(size + n) when n is large enough for
+  rebuilding the whole heap to beat sifting each element in.
+
+  The elements are ordered exactly as if they were offered one at a time
+  from ptrs[0] to ptrs[n - 1]. Their handles are not reported; offer
+  elements singly if they need to be removed or rekeyed later.
 
-  if( q->head == NULL )
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptrs the elements to insert
+  @param n the number of elements in ptrs
+  @return the number of elements in the queue afterwards
+ */
+int priqueue_offer_bulk(priqueue_t *q, void **ptrs, int n)
+{
+  int old_size = q->size;
+  int i;
+
+  if( n <= 0 )
   {
-    node->id = 0;
-    q->head = node;
+    return q->size;
   }
-  else
+
+  reserve( q, q->size + n );
+  for( i = 0; i < n; i++ )
+  {
+    append_node( q, ptrs[i], q->next_seq++ );
+  }
+
+  settle_appended( q, old_size );
+
+  return q->size;
+}
+
+/**
+  Moves every element of src into dst and leaves src empty, in
+  O(size of dst + size of src) when rebuilding the heap is cheaper.
+
+  The elements of src keep their order among themselves and come after
+  any element of dst they tie with, as though they had been offered to
+  dst in their original order after everything already in it. They are
+  ordered by dst's comparer and get new handles; their old handles in src
+  are no longer valid.
+
+  @param dst the queue to merge into
+  @param src the queue to empty, which must not be dst
+  @return the number of elements in dst afterwards
+ */
+int priqueue_merge(priqueue_t *dst, priqueue_t *src)
+{
+  int old_size = dst->size;
+  unsigned long first_seq = src->next_seq;
+  int i;
+
+  if( dst == src || src->size == 0 )
   {
-    struct priqueue_node *curr = q->head;
-    struct priqueue_node *prev = NULL;
+    return dst->size;
+  }
 
-    while( curr != NULL ) 
+  //Shifting src's sequence numbers past dst's keeps their relative order
+  //without having to sort them
+  for( i = 0; i < src->size; i++ )
+  {
+    if( src->heap[i].seq < first_seq )
     {
-      if( (*q->comparer)( node->data, curr->data) > 0 )
-      {
-        if( curr->next == NULL )
-        {
-            curr->next = node;
-            break;
-        }
-        prev = curr;
-        curr = curr->next;
-      }
-      else
-      {
-        if( curr == q->head )
-        {
-          node->next = q->head;
-          q->head = node;
-        }
-        else
-        {
-          node->next = curr;
-          prev->next = node;
-        }
-        break;
-      }
+      first_seq = src->heap[i].seq;
     }
   }
 
-  priqueue_reindex( q );
+  reserve( dst, dst->size + src->size );
+  for( i = 0; i < src->size; i++ )
+  {
+    append_node( dst, src->heap[i].data, dst->next_seq + (src->heap[i].seq - first_seq) );
+  }
+  dst->next_seq += src->next_seq - first_seq;
+
+  settle_appended( dst, old_size );
 
-  return node->id;
+  for( i = 0; i < src->size; i++ )
+  {
+    src->pos[src->heap[i].handle] = -1;
+  }
+  src->size = 0;
+  src->num_free = 0;
+  src->next_handle = 0;
+  src->sorted_valid = 0;
+
+  return dst->size;
 }
 
 /**
@@ -97,10 +468,10 @@ int priqueue_offer(priqueue_t *q, void *ptr)
  */
 void *priqueue_peek(priqueue_t *q)
 {
-  if(q->head == NULL){
+  if(q->size == 0){
       return NULL;
   }
-  return q->head->data;
+  return q->heap[0].data;
 }
 
 
@@ -114,43 +485,41 @@ void *priqueue_peek(priqueue_t *q)
  */
 void *priqueue_poll(priqueue_t *q)
 {
-  if( q->head == NULL )
+  if( q->size == 0 )
   {
     return NULL;
   }
-  
-  struct priqueue_node *node = q->head;
-  void *data = node->data;
-  
-  if(q->head->next != NULL)
-  {
-    q->head = q->head->next;
-    priqueue_reindex( q );
-  }
-  else
-  {
-    q->head = NULL;
-  }
-  free( node );
-  return data;
+
+  return remove_node( q, 0 );
 }
 
+/**
+  Restores the heap order. Call this after changing the key of an element
+  that is already in the queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
 void priqueue_reindex(priqueue_t *q)
 {
-  int index = 0;
-  struct priqueue_node *curr = q->head;
+  int i;
 
-  while( curr != NULL )
+  for( i = 0; i < q->size; i++ )
+  {
+    q->pos[q->heap[i].handle] = i;
+  }
+  for( i = q->size / 2 - 1; i >= 0; i-- )
   {
-    curr->id = index;
-    curr = curr->next;
-    index++;
+    sift_down( q, q->heap, q->pos, q->size, i );
   }
+  q->sorted_valid = 0;
 }
 
 /**
   Returns the element at the specified position in this list, or NULL if
   the queue does not contain an index'th element.
+
+  This is O(1) while the sorted copy of the queue is current; otherwise it
+  is rebuilt first in O(n log n).
  
   @param q a pointer to an instance of the priqueue_t data structure
   @param index position of retrieved element
@@ -159,21 +528,14 @@ void priqueue_reindex(priqueue_t *q)
  */
 void *priqueue_at(priqueue_t *q, int index)
 {
-  struct priqueue_node *node = q->head;
-  
-  while( node != NULL )
+  if( index < 0 || index >= q->size )
   {
-    if( node->id == index )
-    {
-      return node->data;
-    }
-    else
-    {
-      node = node->next;
-    }
+    return NULL;
   }
 
-	return NULL;
+  sort_nodes( q );
+
+  return q->sorted[index].data;
 }
 
 /**
@@ -187,44 +549,27 @@ void *priqueue_at(priqueue_t *q, int index)
  */
 int priqueue_remove(priqueue_t *q, void *ptr)
 {
-  if( q->head == NULL )
-  {
-    return 0;
-  }
-
-  struct priqueue_node *prev = NULL;//Node before the current node
-  struct priqueue_node *curr = q->head;//current node being checked
-
-  int removed = 0;//Number of entries removed
+  int kept = 0;//Nodes that stay in the queue
+  int i;
 
-  while( curr != NULL )
+  for( i = 0; i < q->size; i++ )
   {
-    if( curr->data == ptr )//( (*q->comparer)( curr->data, ptr) == 0 )
+    if( q->heap[i].data != ptr )
     {
-      if( curr == q->head )//we are deleting the head node
-      {
-        q->head = curr->next;
-      }
-      else
-      {
-        prev->next = curr->next;
-      }
-
-      prev = curr;
-      free(curr);//delete curr here;
-      curr = prev->next;
-      
-      removed++;
+      q->heap[kept++] = q->heap[i];
     }
     else
     {
-      prev=curr;
-      curr = curr->next;
-    } 
+      release_handle( q, q->heap[i].handle );
+    }
   }
-  if(removed > 0)//meaning there were deletions
+
+  int removed = q->size - kept;//Number of entries removed
+
+  if( removed > 0 )//meaning there were deletions
   {
-    priqueue_reindex( q );//fix the indexing
+    q->size = kept;
+    priqueue_reindex( q );//fix the heap order
   }
 
 	return removed;
@@ -241,55 +586,167 @@ int priqueue_remove(priqueue_t *q, void *ptr)
  */
 void *priqueue_remove_at(priqueue_t *q, int index)
 {
-  struct priqueue_node *curr = q->head;
-  struct priqueue_node *prev = NULL;
+  if( index < 0 || index >= q->size )
+  {
+    return NULL;
+  }
+
+  sort_nodes( q );
+
+  return remove_node( q, q->pos[q->sorted[index].handle] );
+}
+
+/**
+  Removes the element with the given handle from the queue in O(log n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle priqueue_offer returned for the element
+  @return the element removed from the queue
+  @return NULL if the handle is not in the queue
+ */
+void *priqueue_remove_handle(priqueue_t *q, int handle)
+{
+  int i = handle_pos( q, handle );
 
-  while( curr != NULL )
+  if( i < 0 )
   {
-    if( curr->id == index )
-    {
-      //If we are the head, set head to next node 
-      //If not change the previous nodes next pointer to our next pointer
-      if( q->head == curr )
-      {
-        q->head == curr->next;
-      }
-      else//if we aren't the head, prev should never be NULL
-      {
-        prev->next = curr->next;
-      }
-
-      struct priqueue_node *tmp = curr;
-      free(curr);
-
-      priqueue_reindex( q );
-
-      return tmp;
-    }
+    return NULL;
+  }
+  return remove_node( q, i );
+}
+
+/**
+  Moves an element to its new place after its key has changed in either
+  direction. It keeps its place among elements it ties with.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle priqueue_offer returned for the element
+  @return 0 on success
+  @return -1 if the handle is not in the queue
+ */
+int priqueue_update_key(priqueue_t *q, int handle)
+{
+  int i = handle_pos( q, handle );
 
-    prev = curr;
-    curr = curr->next;
+  if( i < 0 )
+  {
+    return -1;
+  }
+
+  resift( q, i );
+  q->sorted_valid = 0;
+
+  return 0;
+}
+
+/**
+  Moves an element forward after its key has changed so that it compares
+  lower than before. This is cheaper than priqueue_update_key, but the
+  queue is left out of order if the key actually grew.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle priqueue_offer returned for the element
+  @return 0 on success
+  @return -1 if the handle is not in the queue
+ */
+int priqueue_decrease_key(priqueue_t *q, int handle)
+{
+  int i = handle_pos( q, handle );
+
+  if( i < 0 )
+  {
+    return -1;
   }
 
-	return NULL;
+  sift_up( q, q->heap, q->pos, i );
+  q->sorted_valid = 0;
+
+  return 0;
+}
+
+/**
+  Returns the element with the given handle without removing it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle priqueue_offer returned for the element
+  @return the element
+  @return NULL if the handle is not in the queue
+ */
+void *priqueue_get(priqueue_t *q, int handle)
+{
+  int i = handle_pos( q, handle );
+
+  return i < 0 ? NULL : q->heap[i].data;
 }
 
 /**
-  Returns the number of elements in the queue.
+  Returns the number of elements in the queue, in O(1).
  
   @param q a pointer to an instance of the priqueue_t data structure
   @return the number of elements in the queue
  */
 int priqueue_size(priqueue_t *q)
 {
-  struct priqueue_node *curr = q->head;
+  return q->size;
+}
+
+/**
+  Starts a walk over the queue from its head, in the order the elements
+  would be polled.
+
+  The queue may be changed during the walk through priqueue_iter_remove.
+  Other changes are safe, but then which elements the rest of the walk
+  visits is unspecified.
+
+  @param it the iterator to set up
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
+void priqueue_iter_init(priqueue_iter_t *it, priqueue_t *q)
+{
+  sort_nodes( q );
+
+  it->q = q;
+  it->index = 0;
+}
+
+/**
+  Advances the iterator.
+
+  @param it an iterator set up with priqueue_iter_init
+  @return the next element
+  @return NULL once every element has been visited
+ */
+void *priqueue_iter_next(priqueue_iter_t *it)
+{
+  if( it->index >= it->q->size )
+  {
+    return NULL;
+  }
+
+  sort_nodes( it->q );
+
+  return it->q->sorted[it->index++].data;
+}
+
+/**
+  Removes the element the iterator returned last, without disturbing the
+  walk. This is O(log n) for the heap plus a memmove of the sorted copy.
 
-  while( curr->next != NULL )
+  @param it an iterator set up with priqueue_iter_init
+  @return the element removed from the queue
+  @return NULL if priqueue_iter_next has not returned an element yet
+ */
+void *priqueue_iter_remove(priqueue_iter_t *it)
+{
+  if( it->index == 0 || it->index > it->q->size )
   {
-    curr = curr->next;
+    return NULL;
   }
 
-  return (curr->id + 1);
+  sort_nodes( it->q );
+
+  it->index--;
+  return remove_node( it->q, it->q->pos[it->q->sorted[it->index].handle] );
 }
 
 /**
@@ -299,14 +756,17 @@ int priqueue_size(priqueue_t *q)
  */
 void priqueue_destroy(priqueue_t *q)
 {
-  struct priqueue_node *node;
-  
-  //free all nodes inside queue
-  while( q->head != NULL )
-  {
-    node = q->head;
-    q->head = node->next;
-
-    free(node);
-  }
+  free( q->heap );
+  free( q->sorted );
+  free( q->pos );
+  free( q->free_handles );
+
+  q->heap = NULL;
+  q->sorted = NULL;
+  q->pos = NULL;
+  q->free_handles = NULL;
+  q->size = 0;
+  q->capacity = 0;
+  q->num_free = 0;
+  q->next_handle = 0;
 }
@@ -6,35 +6,72 @@
 
 /**
   Priqueue Data Structure
+
+  An array backed binary heap. Each node remembers when it was offered so
+  that elements the comparer does not separate leave first in, first out.
+
+  priqueue_offer returns a handle that names the element for as long as it
+  is queued, for use with priqueue_remove_handle, priqueue_update_key,
+  priqueue_decrease_key and priqueue_get.
 */
 typedef struct priqueue_node
 {
-    int id;
     void *data;
-    struct priqueue_node *next;
+    unsigned long seq;
+    int handle;
 
 } priqueue_node;
 
 typedef struct _priqueue_t
 {
-    struct priqueue_node *head;
+    struct priqueue_node *heap;
+    int size;
+    int capacity;
+    unsigned long next_seq;
+
+    int *pos;
+    int *free_handles;
+    int num_free;
+    int next_handle;
+
+    struct priqueue_node *sorted;
+    int sorted_valid;
+    int sorted_unread;
 
     int (*comparer)( const void *, const void *);
 
 } priqueue_t;
 
+/**
+  Position in a walk over a priqueue_t, from the head to the tail.
+*/
+typedef struct priqueue_iter_t
+{
+    priqueue_t *q;
+    int index;
+
+} priqueue_iter_t;
 
 
 void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
 
 int    priqueue_offer      (priqueue_t *q, void *ptr);
+int    priqueue_offer_bulk (priqueue_t *q, void **ptrs, int n);
+int    priqueue_merge      (priqueue_t *dst, priqueue_t *src);
 void * priqueue_peek       (priqueue_t *q);
 void * priqueue_poll       (priqueue_t *q);
 void * priqueue_at         (priqueue_t *q, int index);
 int    priqueue_remove     (priqueue_t *q, void *ptr);
 void * priqueue_remove_at  (priqueue_t *q, int index);
+void * priqueue_remove_handle (priqueue_t *q, int handle);
+int    priqueue_update_key (priqueue_t *q, int handle);
+int    priqueue_decrease_key (priqueue_t *q, int handle);
+void * priqueue_get        (priqueue_t *q, int handle);
 int    priqueue_size       (priqueue_t *q);
 void   priqueue_reindex    (priqueue_t *q);
+void   priqueue_iter_init  (priqueue_iter_t *it, priqueue_t *q);
+void * priqueue_iter_next  (priqueue_iter_t *it);
+void * priqueue_iter_remove (priqueue_iter_t *it);
 void   priqueue_destroy  (priqueue_t *q);
 
 #endif /* LIBPQUEUE_H_ */
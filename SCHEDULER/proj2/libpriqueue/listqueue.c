@@ -0,0 +1,314 @@
+/** @file listqueue.c
+
+  Every offer and poll walks the list, so each operation is O(n).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "listqueue.h"
+
+/**
+  Initializes the listqueue_t data structure.
+  
+  Assumtions
+    - You may assume this function will only be called once per instance of listqueue_t
+    - You may assume this function will be the first function called using an instance of listqueue_t.
+  @param q a pointer to an instance of the listqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  See also @ref comparer-page
+ */
+void listqueue_init(listqueue_t *q, int(*comparer)(const void *, const void *))
+{
+  if(NULL == q)
+  {
+    printf("\n Node creation failed \n");
+    
+  }
+
+  q->head = NULL;
+
+  q->comparer = comparer;
+}
+
+/**
+  Inserts the specified element into this priority queue.
+
+  @param q a pointer to an instance of the listqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
+ */
+int listqueue_offer(listqueue_t *q, void *ptr)
+{
+  struct listqueue_node *node = (struct listqueue_node*)malloc(sizeof(struct listqueue_node));
+
+  node->next = NULL;
+  node->data = ptr;
+
+  if( q->head == NULL )
+  {
+    node->id = 0;
+    q->head = node;
+  }
+  else
+  {
+    struct listqueue_node *curr = q->head;
+    struct listqueue_node *prev = NULL;
+
+    while( curr != NULL ) 
+    {
+      if( (*q->comparer)( node->data, curr->data) > 0 )
+      {
+        if( curr->next == NULL )
+        {
+            curr->next = node;
+            break;
+        }
+        prev = curr;
+        curr = curr->next;
+      }
+      else
+      {
+        if( curr == q->head )
+        {
+          node->next = q->head;
+          q->head = node;
+        }
+        else
+        {
+          node->next = curr;
+          prev->next = node;
+        }
+        break;
+      }
+    }
+  }
+
+  listqueue_reindex( q );
+
+  return node->id;
+}
+
+/**
+  Retrieves, but does not remove, the head of this queue, returning NULL if
+  this queue is empty.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @return pointer to element at the head of the queue
+  @return NULL if the queue is empty
+ */
+void *listqueue_peek(listqueue_t *q)
+{
+  if(q->head == NULL){
+      return NULL;
+  }
+  return q->head->data;
+}
+
+
+/**
+  Retrieves and removes the head of this queue, or NULL if this queue
+  is empty.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @return the head of this queue
+  @return NULL if this queue is empty
+ */
+void *listqueue_poll(listqueue_t *q)
+{
+  if( q->head == NULL )
+  {
+    return NULL;
+  }
+  
+  struct listqueue_node *node = q->head;
+  void *data = node->data;
+  
+  if(q->head->next != NULL)
+  {
+    q->head = q->head->next;
+    listqueue_reindex( q );
+  }
+  else
+  {
+    q->head = NULL;
+  }
+  free( node );
+  return data;
+}
+
+void listqueue_reindex(listqueue_t *q)
+{
+  int index = 0;
+  struct listqueue_node *curr = q->head;
+
+  while( curr != NULL )
+  {
+    curr->id = index;
+    curr = curr->next;
+    index++;
+  }
+}
+
+/**
+  Returns the element at the specified position in this list, or NULL if
+  the queue does not contain an index'th element.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @param index position of retrieved element
+  @return the index'th element in the queue
+  @return NULL if the queue does not contain the index'th element
+ */
+void *listqueue_at(listqueue_t *q, int index)
+{
+  struct listqueue_node *node = q->head;
+  
+  while( node != NULL )
+  {
+    if( node->id == index )
+    {
+      return node->data;
+    }
+    else
+    {
+      node = node->next;
+    }
+  }
+
+	return NULL;
+}
+
+/**
+  Removes all instances of ptr from the queue. 
+  
+  This function should not use the comparer function, but check if the data contained in each element of the queue is equal (==) to ptr.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @param ptr address of element to be removed
+  @return the number of entries removed
+ */
+int listqueue_remove(listqueue_t *q, void *ptr)
+{
+  if( q->head == NULL )
+  {
+    return 0;
+  }
+
+  struct listqueue_node *prev = NULL;//Node before the current node
+  struct listqueue_node *curr = q->head;//current node being checked
+
+  int removed = 0;//Number of entries removed
+
+  while( curr != NULL )
+  {
+    if( curr->data == ptr )//( (*q->comparer)( curr->data, ptr) == 0 )
+    {
+      if( curr == q->head )//we are deleting the head node
+      {
+        q->head = curr->next;
+      }
+      else
+      {
+        prev->next = curr->next;
+      }
+
+      struct listqueue_node *next = curr->next;
+      free(curr);//delete curr here;
+      curr = next;
+
+      removed++;
+    }
+    else
+    {
+      prev=curr;
+      curr = curr->next;
+    } 
+  }
+  if(removed > 0)//meaning there were deletions
+  {
+    listqueue_reindex( q );//fix the indexing
+  }
+
+	return removed;
+}
+
+/**
+  Removes the specified index from the queue, moving later elements up
+  a spot in the queue to fill the gap.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @param index position of element to be removed
+  @return the element removed from the queue
+  @return NULL if the specified index does not exist
+ */
+void *listqueue_remove_at(listqueue_t *q, int index)
+{
+  struct listqueue_node *curr = q->head;
+  struct listqueue_node *prev = NULL;
+
+  while( curr != NULL )
+  {
+    if( curr->id == index )
+    {
+      //If we are the head, set head to next node 
+      //If not change the previous nodes next pointer to our next pointer
+      if( q->head == curr )
+      {
+        q->head = curr->next;
+      }
+      else//if we aren't the head, prev should never be NULL
+      {
+        prev->next = curr->next;
+      }
+
+      void *data = curr->data;
+      free(curr);
+
+      listqueue_reindex( q );
+
+      return data;
+    }
+
+    prev = curr;
+    curr = curr->next;
+  }
+
+	return NULL;
+}
+
+/**
+  Returns the number of elements in the queue.
+ 
+  @param q a pointer to an instance of the listqueue_t data structure
+  @return the number of elements in the queue
+ */
+int listqueue_size(listqueue_t *q)
+{
+  struct listqueue_node *curr = q->head;
+
+  while( curr->next != NULL )
+  {
+    curr = curr->next;
+  }
+
+  return (curr->id + 1);
+}
+
+/**
+  Destroys and frees all the memory associated with q.
+  
+  @param q a pointer to an instance of the listqueue_t data structure
+ */
+void listqueue_destroy(listqueue_t *q)
+{
+  struct listqueue_node *node;
+  
+  //free all nodes inside queue
+  while( q->head != NULL )
+  {
+    node = q->head;
+    q->head = node->next;
+
+    free(node);
+  }
+}
@@ -0,0 +1,43 @@
+/** @file listqueue.h
+
+  The original sorted linked list priority queue, kept as the baseline
+  that queuebench measures libpriqueue against.
+ */
+
+#ifndef LISTQUEUE_H_
+#define LISTQUEUE_H_
+
+/**
+  Listqueue Data Structure
+*/
+typedef struct listqueue_node
+{
+    int id;
+    void *data;
+    struct listqueue_node *next;
+
+} listqueue_node;
+
+typedef struct _listqueue_t
+{
+    struct listqueue_node *head;
+
+    int (*comparer)( const void *, const void *);
+
+} listqueue_t;
+
+
+
+void   listqueue_init      (listqueue_t *q, int(*comparer)(const void *, const void *));
+
+int    listqueue_offer     (listqueue_t *q, void *ptr);
+void * listqueue_peek      (listqueue_t *q);
+void * listqueue_poll      (listqueue_t *q);
+void * listqueue_at        (listqueue_t *q, int index);
+int    listqueue_remove    (listqueue_t *q, void *ptr);
+void * listqueue_remove_at (listqueue_t *q, int index);
+int    listqueue_size      (listqueue_t *q);
+void   listqueue_reindex   (listqueue_t *q);
+void   listqueue_destroy   (listqueue_t *q);
+
+#endif /* LISTQUEUE_H_ */
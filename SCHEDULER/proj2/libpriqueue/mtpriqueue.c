@@ -0,0 +1,235 @@
+/** @file mtpriqueue.c
+
+  Offers go to a random shard, moving on to the next one whenever a lock
+  is already taken, so producers almost never wait. Polls lock two random
+  shards in index order, which cannot deadlock, and take the better of the
+  two heads. Only when both are empty does a poll sweep every shard, so
+  NULL means the queue really was empty as it was swept.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "mtpriqueue.h"
+
+/** Per-thread state for picking shards */
+static __thread uint32_t shard_seed;
+
+/**
+  Picks a shard index below n with a per-thread xorshift generator.
+ */
+static int random_shard(int n)
+{
+  uint32_t x = shard_seed;
+
+  if( x == 0 )
+  {
+    //Every thread's copy lives at a different address
+    x = (uint32_t)(uintptr_t)&shard_seed | 1;
+  }
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  shard_seed = x;
+
+  return (int)(x % (uint32_t)n);
+}
+
+/**
+  Takes the head of one shard, which the caller has locked.
+ */
+static void *poll_locked(mtpriqueue_t *q, mtpriqueue_shard *shard)
+{
+  void *data = priqueue_poll( &shard->q );
+
+  if( data != NULL )
+  {
+    __atomic_fetch_sub( &q->size, 1, __ATOMIC_RELAXED );
+  }
+  return data;
+}
+
+/**
+  Initializes the mtpriqueue_t data structure.
+
+  @param q a pointer to an instance of the mtpriqueue_t data structure
+  @param comparer a function pointer that compares two elements, as for priqueue_init
+  @param shards the number of shards, or 0 for twice the number of online processors
+  @return 0 on success
+  @return -1 if memory or a lock could not be set up
+ */
+int mtpriqueue_init(mtpriqueue_t *q, int(*comparer)(const void *, const void *), int shards)
+{
+  int i;
+
+  if( shards <= 0 )
+  {
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    shards = cpus > 0 ? 2 * (int)cpus : 2;
+  }
+
+  //Each shard sits on its own cache lines so the locks do not false share
+  if( posix_memalign( (void **)&q->shards, 64, shards * sizeof(mtpriqueue_shard) ) != 0 )
+  {
+    return -1;
+  }
+
+  for( i = 0; i < shards; i++ )
+  {
+    if( pthread_mutex_init( &q->shards[i].lock, NULL ) != 0 )
+    {
+      while( --i >= 0 )
+      {
+        pthread_mutex_destroy( &q->shards[i].lock );
+        priqueue_destroy( &q->shards[i].q );
+      }
+      free( q->shards );
+      return -1;
+    }
+    priqueue_init( &q->shards[i].q, comparer );
+  }
+
+  q->num_shards = shards;
+  q->size = 0;
+  q->comparer = comparer;
+
+  return 0;
+}
+
+/**
+  Inserts the specified element into the queue. Safe to call from any
+  number of threads at once.
+
+  @param q a pointer to an instance of the mtpriqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+ */
+void mtpriqueue_offer(mtpriqueue_t *q, void *ptr)
+{
+  int start = random_shard( q->num_shards );
+  mtpriqueue_shard *shard = NULL;
+  int i;
+
+  for( i = 0; i < q->num_shards; i++ )
+  {
+    mtpriqueue_shard *s = &q->shards[(start + i) % q->num_shards];
+    if( pthread_mutex_trylock( &s->lock ) == 0 )
+    {
+      shard = s;
+      break;
+    }
+  }
+
+  //Every shard was busy; wait for the one picked first
+  if( shard == NULL )
+  {
+    shard = &q->shards[start];
+    pthread_mutex_lock( &shard->lock );
+  }
+
+  priqueue_offer( &shard->q, ptr );
+  __atomic_fetch_add( &q->size, 1, __ATOMIC_RELAXED );
+
+  pthread_mutex_unlock( &shard->lock );
+}
+
+/**
+  Retrieves and removes an element at or near the head of the queue. Safe
+  to call from any number of threads at once.
+
+  @param q a pointer to an instance of the mtpriqueue_t data structure
+  @return the element removed
+  @return NULL if every shard was empty
+ */
+void *mtpriqueue_poll(mtpriqueue_t *q)
+{
+  void *data = NULL;
+  int i;
+
+  if( __atomic_load_n( &q->size, __ATOMIC_RELAXED ) == 0 )
+  {
+    return NULL;
+  }
+
+  if( q->num_shards > 1 )
+  {
+    int a = random_shard( q->num_shards );
+    int b = random_shard( q->num_shards - 1 );
+    if( b >= a )
+    {
+      b++;
+    }
+
+    mtpriqueue_shard *first = &q->shards[a < b ? a : b];
+    mtpriqueue_shard *second = &q->shards[a < b ? b : a];
+
+    pthread_mutex_lock( &first->lock );
+    pthread_mutex_lock( &second->lock );
+
+    void *head1 = priqueue_peek( &first->q );
+    void *head2 = priqueue_peek( &second->q );
+
+    if( head1 != NULL && (head2 == NULL || (*q->comparer)( head1, head2 ) <= 0) )
+    {
+      data = poll_locked( q, first );
+    }
+    else if( head2 != NULL )
+    {
+      data = poll_locked( q, second );
+    }
+
+    pthread_mutex_unlock( &second->lock );
+    pthread_mutex_unlock( &first->lock );
+
+    if( data != NULL )
+    {
+      return data;
+    }
+  }
+
+  int start = random_shard( q->num_shards );
+  for( i = 0; i < q->num_shards && data == NULL; i++ )
+  {
+    mtpriqueue_shard *shard = &q->shards[(start + i) % q->num_shards];
+
+    pthread_mutex_lock( &shard->lock );
+    data = poll_locked( q, shard );
+    pthread_mutex_unlock( &shard->lock );
+  }
+
+  return data;
+}
+
+/**
+  Returns the number of elements in the queue. With other threads running
+  this is only a snapshot.
+
+  @param q a pointer to an instance of the mtpriqueue_t data structure
+  @return the number of elements in the queue
+ */
+int mtpriqueue_size(mtpriqueue_t *q)
+{
+  return __atomic_load_n( &q->size, __ATOMIC_RELAXED );
+}
+
+/**
+  Destroys and frees all the memory associated with q. No other thread may
+  be using the queue.
+
+  @param q a pointer to an instance of the mtpriqueue_t data structure
+ */
+void mtpriqueue_destroy(mtpriqueue_t *q)
+{
+  int i;
+
+  for( i = 0; i < q->num_shards; i++ )
+  {
+    pthread_mutex_destroy( &q->shards[i].lock );
+    priqueue_destroy( &q->shards[i].q );
+  }
+  free( q->shards );
+
+  q->shards = NULL;
+  q->num_shards = 0;
+  q->size = 0;
+}
@@ -0,0 +1,47 @@
+/** @file mtpriqueue.h
+ */
+
+#ifndef MTPRIQUEUE_H_
+#define MTPRIQUEUE_H_
+
+#include <pthread.h>
+
+#include "libpriqueue.h"
+
+/**
+  Thread-safe priority queue for any number of producers and consumers.
+
+  Elements are spread over several shards, each an ordinary priqueue_t
+  behind its own lock, so threads working on different shards do not
+  contend. A poll looks at the heads of two shards picked at random and
+  takes the better one, which keeps the order close to, but not exactly,
+  the global priority order. With a single shard elements come out in
+  exactly the order priqueue_t would give.
+*/
+typedef struct mtpriqueue_shard
+{
+    pthread_mutex_t lock;
+    priqueue_t q;
+
+} __attribute__((aligned(64))) mtpriqueue_shard;
+
+typedef struct _mtpriqueue_t
+{
+    mtpriqueue_shard *shards;
+    int num_shards;
+    int size;
+
+    int (*comparer)( const void *, const void *);
+
+} mtpriqueue_t;
+
+
+
+int    mtpriqueue_init     (mtpriqueue_t *q, int(*comparer)(const void *, const void *), int shards);
+
+void   mtpriqueue_offer    (mtpriqueue_t *q, void *ptr);
+void * mtpriqueue_poll     (mtpriqueue_t *q);
+int    mtpriqueue_size     (mtpriqueue_t *q);
+void   mtpriqueue_destroy  (mtpriqueue_t *q);
+
+#endif /* MTPRIQUEUE_H_ */
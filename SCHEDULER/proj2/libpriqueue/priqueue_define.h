@@ -0,0 +1,230 @@
+/** @file priqueue_define.h
+
+  Generates a priority queue specialized for one element type.
+
+  PRIQUEUE_DEFINE(name, T, KEY_EXPR) defines name_t and static inline
+  name_init, name_destroy, name_offer, name_peek, name_poll and name_size,
+  along with name_iter_t, name_iter_init and name_iter_next for walking
+  the queue in order. KEY_EXPR is evaluated once when an element x of type T is
+  offered and must give an integer; lower keys leave the queue first and
+  equal keys leave in the order they were offered. Each key is stored in
+  the heap array right next to its element, so comparisons are inlined
+  integer compares rather than calls through a comparer that follows
+  pointers.
+
+  Keys are computed on offer and are not updated afterwards, so an element
+  whose key changes has to be polled and offered again.
+
+  Walking the queue uses a sorted copy of the heap, which offer and poll
+  keep current once it exists, the same way libpriqueue does.
+ */
+
+#ifndef PRIQUEUE_DEFINE_H_
+#define PRIQUEUE_DEFINE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Changes the sorted copy absorbs without being read before it is dropped */
+#define PRIQUEUE_SORTED_MAX_UNREAD 32
+
+#define PRIQUEUE_DEFINE(name, T, KEY_EXPR)                                    \
+                                                                              \
+typedef struct name##_entry                                                   \
+{                                                                             \
+    long long key;                                                            \
+    unsigned long seq;                                                        \
+    T value;                                                                  \
+} name##_entry;                                                               \
+                                                                              \
+typedef struct name##_t                                                       \
+{                                                                             \
+    name##_entry *heap;                                                       \
+    int size;                                                                 \
+    int capacity;                                                             \
+    unsigned long next_seq;                                                   \
+    name##_entry *sorted;                                                     \
+    int sorted_valid;                                                         \
+    int sorted_unread;                                                        \
+} name##_t;                                                                   \
+                                                                              \
+typedef struct name##_iter_t                                                  \
+{                                                                             \
+    name##_t *q;                                                              \
+    int index;                                                                \
+} name##_iter_t;                                                              \
+                                                                              \
+static inline long long name##_key(T x)                                       \
+{                                                                             \
+  (void)x;                                                                    \
+  return (KEY_EXPR);                                                          \
+}                                                                             \
+                                                                              \
+static inline int name##_before(const name##_entry *a, const name##_entry *b) \
+{                                                                             \
+  return a->key < b->key || (a->key == b->key && a->seq < b->seq);            \
+}                                                                             \
+                                                                              \
+static inline void name##_sift_down(name##_entry *heap, int size, int i)      \
+{                                                                             \
+  name##_entry node = heap[i];                                                \
+                                                                              \
+  while( 2 * i + 1 < size )                                                   \
+  {                                                                           \
+    int child = 2 * i + 1;                                                    \
+    if( child + 1 < size && name##_before( &heap[child + 1], &heap[child] ) ) \
+    {                                                                         \
+      child++;                                                                \
+    }                                                                         \
+    if( !name##_before( &heap[child], &node ) )                               \
+    {                                                                         \
+      break;                                                                  \
+    }                                                                         \
+    heap[i] = heap[child];                                                    \
+    i = child;                                                                \
+  }                                                                           \
+  heap[i] = node;                                                             \
+}                                                                             \
+                                                                              \
+static inline void name##_init(name##_t *q)                                   \
+{                                                                             \
+  q->heap = NULL;                                                             \
+  q->size = 0;                                                                \
+  q->capacity = 0;                                                            \
+  q->next_seq = 0;                                                            \
+  q->sorted = NULL;                                                           \
+  q->sorted_valid = 0;                                                        \
+  q->sorted_unread = 0;                                                       \
+}                                                                             \
+                                                                              \
+static inline void name##_destroy(name##_t *q)                                \
+{                                                                             \
+  free( q->heap );                                                            \
+  free( q->sorted );                                                          \
+  name##_init( q );                                                           \
+}                                                                             \
+                                                                              \
+/* Whether to keep the sorted copy through one more change */                 \
+static inline int name##_sorted_keep(name##_t *q)                             \
+{                                                                             \
+  if( q->sorted_valid && ++q->sorted_unread > PRIQUEUE_SORTED_MAX_UNREAD )    \
+  {                                                                           \
+    q->sorted_valid = 0;                                                      \
+  }                                                                           \
+  return q->sorted_valid;                                                     \
+}                                                                             \
+                                                                              \
+static inline void name##_offer(name##_t *q, T value)                         \
+{                                                                             \
+  if( q->size == q->capacity )                                                \
+  {                                                                           \
+    q->capacity = q->capacity ? q->capacity * 2 : 16;                         \
+    q->heap = realloc( q->heap, q->capacity * sizeof(name##_entry) );         \
+    q->sorted = realloc( q->sorted, q->capacity * sizeof(name##_entry) );     \
+  }                                                                           \
+                                                                              \
+  name##_entry node;                                                          \
+  node.key = name##_key( value );                                             \
+  node.seq = q->next_seq++;                                                   \
+  node.value = value;                                                         \
+                                                                              \
+  if( name##_sorted_keep( q ) )                                               \
+  {                                                                           \
+    int lo = 0, hi = q->size;                                                 \
+    while( lo < hi )                                                          \
+    {                                                                         \
+      int mid = lo + (hi - lo) / 2;                                           \
+      if( name##_before( &q->sorted[mid], &node ) )                           \
+      {                                                                       \
+        lo = mid + 1;                                                         \
+      }                                                                       \
+      else                                                                    \
+      {                                                                       \
+        hi = mid;                                                             \
+      }                                                                       \
+    }                                                                         \
+    memmove( &q->sorted[lo + 1], &q->sorted[lo],                              \
+             (q->size - lo) * sizeof(name##_entry) );                         \
+    q->sorted[lo] = node;                                                     \
+  }                                                                           \
+                                                                              \
+  int i = q->size++;                                                          \
+  while( i > 0 && name##_before( &node, &q->heap[(i - 1) / 2] ) )             \
+  {                                                                           \
+    q->heap[i] = q->heap[(i - 1) / 2];                                        \
+    i = (i - 1) / 2;                                                          \
+  }                                                                           \
+  q->heap[i] = node;                                                          \
+}                                                                             \
+                                                                              \
+static inline int name##_size(const name##_t *q)                              \
+{                                                                             \
+  return q->size;                                                             \
+}                                                                             \
+                                                                              \
+/* Copies the head to *out; returns 0 if the queue is empty */                \
+static inline int name##_peek(const name##_t *q, T *out)                      \
+{                                                                             \
+  if( q->size == 0 )                                                          \
+  {                                                                           \
+    return 0;                                                                 \
+  }                                                                           \
+  *out = q->heap[0].value;                                                    \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/* Moves the head to *out; returns 0 if the queue is empty */                 \
+static inline int name##_poll(name##_t *q, T *out)                            \
+{                                                                             \
+  if( q->size == 0 )                                                          \
+  {                                                                           \
+    return 0;                                                                 \
+  }                                                                           \
+  *out = q->heap[0].value;                                                    \
+  if( name##_sorted_keep( q ) )                                               \
+  {                                                                           \
+    memmove( &q->sorted[0], &q->sorted[1],                                    \
+             (q->size - 1) * sizeof(name##_entry) );                          \
+  }                                                                           \
+  q->heap[0] = q->heap[--q->size];                                            \
+  name##_sift_down( q->heap, q->size, 0 );                                    \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/* Starts a walk over the queue in the order it would be polled */            \
+static inline void name##_iter_init(name##_iter_t *it, name##_t *q)           \
+{                                                                             \
+  q->sorted_unread = 0;                                                       \
+  if( !q->sorted_valid )                                                      \
+  {                                                                           \
+    name##_entry *work = malloc( q->size * sizeof(name##_entry) + 1 );        \
+    int size = q->size;                                                       \
+    int i;                                                                    \
+                                                                              \
+    memcpy( work, q->heap, q->size * sizeof(name##_entry) );                  \
+    for( i = 0; i < q->size; i++ )                                            \
+    {                                                                         \
+      q->sorted[i] = work[0];                                                 \
+      work[0] = work[--size];                                                 \
+      name##_sift_down( work, size, 0 );                                      \
+    }                                                                         \
+    free( work );                                                             \
+    q->sorted_valid = 1;                                                      \
+  }                                                                           \
+                                                                              \
+  it->q = q;                                                                  \
+  it->index = 0;                                                              \
+}                                                                             \
+                                                                              \
+/* Copies the next element to *out; returns 0 once all have been visited */   \
+static inline int name##_iter_next(name##_iter_t *it, T *out)                 \
+{                                                                             \
+  if( it->index >= it->q->size || !it->q->sorted_valid )                      \
+  {                                                                           \
+    return 0;                                                                 \
+  }                                                                           \
+  *out = it->q->sorted[it->index++].value;                                    \
+  return 1;                                                                   \
+}
+
+#endif /* PRIQUEUE_DEFINE_H_ */
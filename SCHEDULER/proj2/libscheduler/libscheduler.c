@@ -7,118 +7,219 @@
 #include <assert.h>
 
 #include "libscheduler.h"
-#include "../libpriqueue/libpriqueue.h"
+#include "pool.h"
+#include "log.h"
+#include "../libpriqueue/priqueue_define.h"
 
-#define ARRIVAL_TIME_A (core_array[i]->current_job->time)
-#define ARRIVAL_TIME_B (core_array[flagged]->current_job->time)
-#define REMAINING_TIME_A (core_array[i]->current_job->running_time-(time-core_array[i]->current_job->placed_on_core))
-#define REMAINING_TIME_B (core_array[flagged]->current_job->running_time-(time-core_array[flagged]->current_job->placed_on_core))
-#define PRIORITY_A (core_array[i]->current_job->priority)
-#define PRIORITY_B (core_array[flagged]->current_job->priority)
+#define ARRIVAL_TIME_A (s->core_array[i]->current_job->time)
+#define ARRIVAL_TIME_B (s->core_array[flagged]->current_job->time)
+#define REMAINING_TIME_A (s->core_array[i]->current_job->running_time-(time-s->core_array[i]->current_job->placed_on_core))
+#define REMAINING_TIME_B (s->core_array[flagged]->current_job->running_time-(time-s->core_array[flagged]->current_job->placed_on_core))
+#define PRIORITY_A (s->core_array[i]->current_job->priority)
+#define PRIORITY_B (s->core_array[flagged]->current_job->priority)
+
+/** Number of job_t allocated from the system at a time */
+#define JOBS_PER_CHUNK 256
 
 /**
-  Stores information making up a job to be scheduled including any statistics.
+  Queue keys for each scheme. A job with a lower key runs first, and jobs
+  with equal keys run in the order they were queued.
 
-  You may need to define some global variables or a struct to store your job queue elements. 
+  SJF and PRI break ties on the arrival time, which the simulator
+  guarantees is unique, so it is packed below the running time or
+  priority in the same key.
 */
+#define ARRIVAL_KEY(job, major) ((long long)(major) * 4294967296LL + (unsigned int)(job)->time)
+#define FIFO_KEY(job) 0
+#define SJF_KEY(job) ARRIVAL_KEY(job, (job)->running_time)
+#define PRI_KEY(job) ARRIVAL_KEY(job, (job)->priority)
 
-int total_job_waiting_time = 0;
-int total_turnaround_time = 0;
-int total_response_time = 0;
-int jobs_finished = 0;
-int num_cores;
-priqueue_t job_queue;
-core_t **core_array;
-scheme_t pri_scheme;
+PRIQUEUE_DEFINE(fifo_queue, job_t *, FIFO_KEY(x))
+PRIQUEUE_DEFINE(sjf_queue, job_t *, SJF_KEY(x))
+PRIQUEUE_DEFINE(pri_queue, job_t *, PRI_KEY(x))
 
-int fifo_compare(const void * a, const void * b)
+/**
+  Everything one scheduler keeps: its cores, its job queue and the
+  running totals behind the averages.
+*/
+struct scheduler_t
 {
-    return (1);
-}
+    long long total_job_waiting_time;
+    long long total_turnaround_time;
+    long long total_response_time;
+    int jobs_finished;
+    int num_cores;
+    core_t **core_array;
+    scheme_t pri_scheme;
+    pool_t job_pool;
+    bool quiet;
+    FILE *event_log;
+
+    /** Only the queue for pri_scheme is used */
+    fifo_queue_t fifo_jobs;
+    sjf_queue_t sjf_jobs;
+    pri_queue_t pri_jobs;
+};
+
+/** The scheduler behind the scheduler_* calls that take no context */
+static scheduler_t *default_scheduler;
 
-int sjf_compare(const void * a, const void * b)
+/**
+  The scheduler's running commentary, at LOG_DEBUG unless the scheduler
+  has been quieted.
+*/
+#define CHATTER(s, ...)                                                       \
+    do                                                                        \
+    {                                                                         \
+        if (LOG_ENABLED(LOG_DEBUG) && !(s)->quiet)                            \
+            log_printf(__VA_ARGS__);                                          \
+    } while (0)
+
+static void queue_offer(scheduler_t *s, job_t *job)
 {
-    const job_t * job1 = a;
-	  const job_t * job2 = b;
-    
-    if((job1->running_time - job2->running_time) == 0)
+    switch(s->pri_scheme)
     {
-        if(job1->time > job2->time)
-        {
-            return (1);
-        }
-        
+        case SJF:
+        case PSJF:
+            sjf_queue_offer(&s->sjf_jobs, job);
+            break;
+        case PRI:
+        case PPRI:
+            pri_queue_offer(&s->pri_jobs, job);
+            break;
+        default:
+            fifo_queue_offer(&s->fifo_jobs, job);
+            break;
     }
-	  return ( job1->running_time - job2->running_time );
 }
 
-int pri_compare(const void * a, const void * b)
+/**
+  Takes the next job off the queue, or NULL if there is none.
+*/
+static job_t *queue_poll(scheduler_t *s)
 {
-    const job_t * job1 = a;
-	  const job_t * job2 = b;
-    
-    if((job1->priority - job2->priority) == 0)
+    job_t *job = NULL;
+    switch(s->pri_scheme)
     {
-        if(job1->time > job2->time)
-        {
-            return (1);
-        }
-        
+        case SJF:
+        case PSJF:
+            sjf_queue_poll(&s->sjf_jobs, &job);
+            break;
+        case PRI:
+        case PPRI:
+            pri_queue_poll(&s->pri_jobs, &job);
+            break;
+        default:
+            fifo_queue_poll(&s->fifo_jobs, &job);
+            break;
     }
-	  return ( job1->priority - job2->priority );
+    return job;
+}
+
+static void show_job(job_t *data)
+{
+    printf(" [Jn:%d, rt:%d, pri:%d] ->", data->job_number,data->running_time,data->priority );
 }
 
 /**
-  Initalizes the scheduler.
+  Creates a scheduler. Schedulers share no state, so any number of them
+  can be used at once, each from its own thread.
  
   Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called once once.
     - You may assume that cores is a positive, non-zero number.
     - You may assume that scheme is a valid scheduling scheme.
 
   @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
   @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+  @return the new scheduler, to be freed with scheduler_destroy
 */
-void scheduler_start_up(int cores, scheme_t scheme)
+scheduler_t *scheduler_create(int cores, scheme_t scheme)
 {
-    num_cores = cores;
-    pri_scheme = scheme;
-    switch(pri_scheme)
+    scheduler_t *s = calloc(1, sizeof(scheduler_t));
+    s->num_cores = cores;
+    s->pri_scheme = scheme;
+    pool_init(&s->job_pool, sizeof(job_t), JOBS_PER_CHUNK);
+    switch(s->pri_scheme)
     {
         case FCFS:
-            priqueue_init(&job_queue,fifo_compare);
+        case RR:
+            fifo_queue_init(&s->fifo_jobs);
             break;
         case SJF:
-            priqueue_init(&job_queue,sjf_compare);
-            break;
         case PSJF:
-            priqueue_init(&job_queue,sjf_compare);
+            sjf_queue_init(&s->sjf_jobs);
             break;
         case PRI:
-            priqueue_init(&job_queue,pri_compare);
-            break;
         case PPRI:
-            priqueue_init(&job_queue,pri_compare);
+            pri_queue_init(&s->pri_jobs);
             break;
-        case RR:
-            priqueue_init(&job_queue,fifo_compare);
-            break;                      
         default:
-            printf("Invalid value for scheme!!! Received: %d\n",pri_scheme );
+            printf("Invalid value for scheme!!! Received: %d\n",s->pri_scheme );
             break;                          
     }
 
     int i = 0;
 
-    core_array = calloc(num_cores, sizeof(core_t*));
-    while(i<num_cores)
+    s->core_array = calloc(s->num_cores, sizeof(core_t*));
+    while(i<s->num_cores)
     {
         struct core_t *tmp = (struct core_t*)malloc(sizeof(struct core_t));
         tmp->current_job = NULL;
-        core_array[i]=tmp;
+        s->core_array[i]=tmp;
         i++;
     }
+    return s;
+}
+
+
+/**
+  Turns the scheduler's running commentary on stdout off or back on.
+  Schedulers start out with it on.
+
+  @param s the scheduler
+  @param quiet true to print nothing but what is asked for explicitly
+*/
+void scheduler_set_quiet(scheduler_t *s, bool quiet)
+{
+    s->quiet = quiet;
+}
+
+
+/**
+  Starts recording every decision the scheduler makes to a binary event
+  log, which replay can later feed back to a scheduler. The file stays
+  the caller's to close, after the scheduler is done with it.
+
+  @param s the scheduler, before it has been given any jobs
+  @param file the log, open for writing, or NULL to stop recording
+  @return 0 on success, -1 if the log could not be written
+*/
+int scheduler_set_event_log(scheduler_t *s, FILE *file)
+{
+    s->event_log = file;
+    if(file == NULL)
+    {
+        return 0;
+    }
+    return log_write_header(file, s->num_cores, s->pri_scheme);
+}
+
+static void record(scheduler_t *s, int type, int time, int job, int core, int running_time, int priority, int decision)
+{
+    log_event_t event;
+
+    if(s->event_log == NULL)
+    {
+        return;
+    }
+    event.type = type;
+    event.time = time;
+    event.job = job;
+    event.core = core;
+    event.running_time = running_time;
+    event.priority = priority;
+    event.decision = decision;
+    log_write_event(s->event_log, &event);
 }
 
 
@@ -143,10 +244,10 @@ void scheduler_start_up(int cores, scheme_t scheme)
   @return -1 if no scheduling changes should be made. 
  
  */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
+static int new_job(scheduler_t *s, int job_number, int time, int running_time, int priority)
 {
     
-    struct job_t *tmp = (struct job_t*)malloc(sizeof(struct job_t));
+    struct job_t *tmp = pool_alloc(&s->job_pool);
     tmp->time = time;
     tmp->job_number = job_number;
     tmp->running_time = running_time;
@@ -157,63 +258,63 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
     
     int i = 0;
     int flagged = 0;
-    switch(pri_scheme)
+    switch(s->pri_scheme)
     {
         case FCFS:
-            printf("FCFS schedule\n");
-            while(i<num_cores)
+            CHATTER(s, "FCFS schedule\n");
+            while(i<s->num_cores)
             {
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
             }
-            priqueue_offer(&job_queue,tmp);
+            queue_offer(s, tmp);
             break;
         case SJF:
-            printf("SJF schedule\n");
-            while(i<num_cores)
+            CHATTER(s, "SJF schedule\n");
+            while(i<s->num_cores)
             {
                 //I think jobs with same running_time are being ordered incorrectly in the queue
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }                    
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
             }
             
-            priqueue_offer(&job_queue,tmp);
+            queue_offer(s, tmp);
             break;
         case PSJF:
-            printf("PSJF schedule\n");
+            CHATTER(s, "PSJF schedule\n");
 
             ///Check for idle cores
-            while(i<num_cores)
+            while(i<s->num_cores)
             {
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }                                        
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
@@ -222,7 +323,7 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
             ///find core with job with most time remaining.
             i=1;
             flagged = 0;
-            while(i<num_cores)
+            while(i<s->num_cores)
             {
                 if((REMAINING_TIME_A) == (REMAINING_TIME_B))
                 {
@@ -239,69 +340,69 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
             i++;
             }
             
-            printf("The longest job is on core %d\n",flagged);
+            CHATTER(s, "The longest job is on core %d\n",flagged);
             
             ///figure out if longest job remaining is longer than the job that jsut arrived.
-            printf("Job %d runtime %d is less than Job %d runtime %d\n",core_array[flagged]->current_job->job_number,REMAINING_TIME_B,tmp->job_number,tmp->running_time);
+            CHATTER(s, "Job %d runtime %d is less than Job %d runtime %d\n",s->core_array[flagged]->current_job->job_number,REMAINING_TIME_B,tmp->job_number,tmp->running_time);
             if((REMAINING_TIME_B) > (tmp->running_time))
             {
-                printf("placed job %d into the queue. Placed job %d onto core %d!\n",core_array[flagged]->current_job->job_number,tmp->job_number,flagged);
-                core_array[flagged]->current_job->running_time = REMAINING_TIME_B;
-                core_array[flagged]->current_job->time_placed_in_queue = time;
-                if(core_array[flagged]->current_job->first_placed_on_core == time)
+                CHATTER(s, "placed job %d into the queue. Placed job %d onto core %d!\n",s->core_array[flagged]->current_job->job_number,tmp->job_number,flagged);
+                s->core_array[flagged]->current_job->running_time = REMAINING_TIME_B;
+                s->core_array[flagged]->current_job->time_placed_in_queue = time;
+                if(s->core_array[flagged]->current_job->first_placed_on_core == time)
                 {
-                    core_array[flagged]->current_job->previously_scheduled = false;
+                    s->core_array[flagged]->current_job->previously_scheduled = false;
                 }
-                priqueue_offer(&job_queue,core_array[flagged]->current_job);
+                queue_offer(s, s->core_array[flagged]->current_job);
                 tmp->placed_on_core = time;
                 if(!tmp->previously_scheduled){
                     tmp->first_placed_on_core = time;
                 }                                    
                 tmp->previously_scheduled = true;
-                core_array[flagged]->current_job = tmp;
+                s->core_array[flagged]->current_job = tmp;
                 return flagged;
             }
             else
             {
-                printf("Placed the new job, job: %d, into the queue.",tmp->job_number);
-                priqueue_offer(&job_queue,tmp);
+                CHATTER(s, "Placed the new job, job: %d, into the queue.",tmp->job_number);
+                queue_offer(s, tmp);
                 return -1;    
             }
             break;
         case PRI:
-            printf("PRI schedule\n");
-            while(i<num_cores)
+            CHATTER(s, "PRI schedule\n");
+            while(i<s->num_cores)
             {
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }                                        
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
             }
             
-            priqueue_offer(&job_queue,tmp);
+            queue_offer(s, tmp);
             break;
         case PPRI:
-            printf("PPRI schedule\n");
+            CHATTER(s, "PPRI schedule\n");
             //Check for idle cores
-            while(i<num_cores)
+            while(i<s->num_cores)
             {
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }                                        
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
@@ -310,7 +411,7 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
             ///find core with job with most time remaining.
             i=1;
             flagged = 0;
-            while(i<num_cores)
+            while(i<s->num_cores)
             {
                 if((PRIORITY_A) == (PRIORITY_B))
                 {
@@ -327,55 +428,55 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
             i++;
             }
             
-            printf("The priority closes to 0 job is on core %d\n",flagged);
+            CHATTER(s, "The priority closes to 0 job is on core %d\n",flagged);
             
             ///figure out if longest job remaining is longer than the job that jsut arrived.
             if((PRIORITY_B) > (tmp->priority))
             {
-                printf("placed job %d into the queue. Placed job %d onto core %d!\n",core_array[flagged]->current_job->job_number,tmp->job_number,flagged);
-                core_array[flagged]->current_job->running_time = REMAINING_TIME_B;
-                core_array[flagged]->current_job->time_placed_in_queue = time;
-                if(core_array[flagged]->current_job->first_placed_on_core == time)
+                CHATTER(s, "placed job %d into the queue. Placed job %d onto core %d!\n",s->core_array[flagged]->current_job->job_number,tmp->job_number,flagged);
+                s->core_array[flagged]->current_job->running_time = REMAINING_TIME_B;
+                s->core_array[flagged]->current_job->time_placed_in_queue = time;
+                if(s->core_array[flagged]->current_job->first_placed_on_core == time)
                 {
-                    core_array[flagged]->current_job->previously_scheduled = false;
+                    s->core_array[flagged]->current_job->previously_scheduled = false;
                 }
-                priqueue_offer(&job_queue,core_array[flagged]->current_job);
+                queue_offer(s, s->core_array[flagged]->current_job);
                 tmp->placed_on_core = time;
                 if(!tmp->previously_scheduled){
                     tmp->first_placed_on_core = time;
                 }                                    
                 tmp->previously_scheduled = true;
-                core_array[flagged]->current_job = tmp;
+                s->core_array[flagged]->current_job = tmp;
                 return flagged;
             }
             else
             {
-                printf("Placed the new job, job: %d, into the queue.",tmp->job_number);
-                priqueue_offer(&job_queue,tmp);
+                CHATTER(s, "Placed the new job, job: %d, into the queue.",tmp->job_number);
+                queue_offer(s, tmp);
                 return -1;    
             }
             break;       
         case RR:
-            printf("RR schedule\n");
-            while(i<num_cores)
+            CHATTER(s, "RR schedule\n");
+            while(i<s->num_cores)
             {
-                if(core_array[i]->current_job == NULL)
+                if(s->core_array[i]->current_job == NULL)
                 {
                     tmp->placed_on_core = time;
                     if(!tmp->previously_scheduled){
                         tmp->first_placed_on_core = time;
                     }                                        
                     tmp->previously_scheduled = true;
-                    core_array[i]->current_job = tmp;
-                    printf("Assigned job %d to core number %d\n",job_number,i);
+                    s->core_array[i]->current_job = tmp;
+                    CHATTER(s, "Assigned job %d to core number %d\n",job_number,i);
                     return i;
                 }
             i++;
             }
-            priqueue_offer(&job_queue,tmp);
+            queue_offer(s, tmp);
             break;                                         
         default:
-            printf("Invalid value for scheme!!! Received: %d\n",pri_scheme );
+            printf("Invalid value for scheme!!! Received: %d\n",s->pri_scheme );
             break;
     }
 	  return -1;
@@ -396,29 +497,29 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
   @return job_number of the job that should be scheduled to run on core core_id
   @return -1 if core should remain idle.
  */
-int scheduler_job_finished(int core_id, int job_number, int time)
+static int job_finished(scheduler_t *s, int core_id, int job_number, int time)
 {
-    jobs_finished++;
-    total_turnaround_time+=(time-core_array[core_id]->current_job->time);
-    free(core_array[core_id]->current_job);
-    struct job_t* queued_job = priqueue_poll(&job_queue);
+    s->jobs_finished++;
+    s->total_turnaround_time+=(time-s->core_array[core_id]->current_job->time);
+    pool_free(&s->job_pool, s->core_array[core_id]->current_job);
+    struct job_t* queued_job = queue_poll(s);
     
-    core_array[core_id]->current_job = queued_job;
+    s->core_array[core_id]->current_job = queued_job;
     
-    if(core_array[core_id]->current_job != NULL)
+    if(s->core_array[core_id]->current_job != NULL)
     {
-    core_array[core_id]->current_job->placed_on_core = time;
-        total_job_waiting_time+=(time-core_array[core_id]->current_job->time_placed_in_queue);
-        if(!core_array[core_id]->current_job->previously_scheduled)
+    s->core_array[core_id]->current_job->placed_on_core = time;
+        s->total_job_waiting_time+=(time-s->core_array[core_id]->current_job->time_placed_in_queue);
+        if(!s->core_array[core_id]->current_job->previously_scheduled)
         {
-            total_response_time+=(time-core_array[core_id]->current_job->time_placed_in_queue);
-            if(!core_array[core_id]->current_job->previously_scheduled){
-                core_array[core_id]->current_job->first_placed_on_core = time;
+            s->total_response_time+=(time-s->core_array[core_id]->current_job->time_placed_in_queue);
+            if(!s->core_array[core_id]->current_job->previously_scheduled){
+                s->core_array[core_id]->current_job->first_placed_on_core = time;
             }                                
-            core_array[core_id]->current_job->previously_scheduled = true;
+            s->core_array[core_id]->current_job->previously_scheduled = true;
         }
-        printf("Job was waiting in queue for %d time cycles!",time-core_array[core_id]->current_job->time);
-        return core_array[core_id]->current_job->job_number;
+        CHATTER(s, "Job was waiting in queue for %d time cycles!",time-s->core_array[core_id]->current_job->time);
+        return s->core_array[core_id]->current_job->job_number;
     }
 	  return -1;
 }
@@ -437,25 +538,67 @@ int scheduler_job_finished(int core_id, int job_number, int time)
   @return job_number of the job that should be scheduled on core cord_id
   @return -1 if core should remain idle
  */
-int scheduler_quantum_expired(int core_id, int time)
+static int quantum_expired(scheduler_t *s, int core_id, int time)
 {
-    printf("Quatum expired!\n");
+    CHATTER(s, "Quatum expired!\n");
     
     /////maybe call the job_finished function if the quantum happens when the job is scheduled to finish anyways.
-    core_array[core_id]->current_job->time_placed_in_queue = time;
-    priqueue_offer(&job_queue,core_array[core_id]->current_job);
+    s->core_array[core_id]->current_job->time_placed_in_queue = time;
+    queue_offer(s, s->core_array[core_id]->current_job);
     
-    struct job_t* queued_job = priqueue_poll(&job_queue);
-    core_array[core_id]->current_job = queued_job;
-    total_job_waiting_time+=(time-core_array[core_id]->current_job->time_placed_in_queue);
+    struct job_t* queued_job = queue_poll(s);
+    s->core_array[core_id]->current_job = queued_job;
+    s->total_job_waiting_time+=(time-s->core_array[core_id]->current_job->time_placed_in_queue);
     
-    if(!core_array[core_id]->current_job->previously_scheduled)
+    if(!s->core_array[core_id]->current_job->previously_scheduled)
     {
-        total_response_time+=(time-core_array[core_id]->current_job->time_placed_in_queue);
-        core_array[core_id]->current_job->previously_scheduled = true;
+        s->total_response_time+=(time-s->core_array[core_id]->current_job->time_placed_in_queue);
+        s->core_array[core_id]->current_job->previously_scheduled = true;
     }            
     
-    return core_array[core_id]->current_job->job_number;
+    return s->core_array[core_id]->current_job->job_number;
+}
+
+
+/**
+  Hands a scheduler a job that has just arrived; see new_job.
+
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_new_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority)
+{
+    int core_id = new_job(s, job_number, time, running_time, priority);
+    record(s, LOG_EVENT_ARRIVAL, time, job_number, -1, running_time, priority, core_id);
+    return core_id;
+}
+
+
+/**
+  Tells a scheduler a job has finished; see job_finished.
+
+  @return job_number of the job that should be scheduled to run on core core_id
+  @return -1 if core should remain idle.
+ */
+int scheduler_job_finished_r(scheduler_t *s, int core_id, int job_number, int time)
+{
+    int next_job = job_finished(s, core_id, job_number, time);
+    record(s, LOG_EVENT_FINISHED, time, job_number, core_id, 0, 0, next_job);
+    return next_job;
+}
+
+
+/**
+  Tells a scheduler a core's quantum has expired; see quantum_expired.
+
+  @return job_number of the job that should be scheduled on core core_id
+  @return -1 if core should remain idle
+ */
+int scheduler_quantum_expired_r(scheduler_t *s, int core_id, int time)
+{
+    int next_job = quantum_expired(s, core_id, time);
+    record(s, LOG_EVENT_EXPIRED, time, -1, core_id, 0, 0, next_job);
+    return next_job;
 }
 
 
@@ -468,9 +611,9 @@ int scheduler_quantum_expired(int core_id, int time)
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average waiting time of all jobs scheduled.
  */
-float scheduler_average_waiting_time()
+float scheduler_average_waiting_time_r(scheduler_t *s)
 {
-	  return ((float)total_job_waiting_time/(float)jobs_finished);
+	  return ((float)s->total_job_waiting_time/(float)s->jobs_finished);
 }
 
 
@@ -483,9 +626,9 @@ float scheduler_average_waiting_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average turnaround time of all jobs scheduled.
  */
-float scheduler_average_turnaround_time()
+float scheduler_average_turnaround_time_r(scheduler_t *s)
 {
-	  return ((float)total_turnaround_time/(float)jobs_finished);
+	  return ((float)s->total_turnaround_time/(float)s->jobs_finished);
 }
 
 
@@ -498,28 +641,31 @@ float scheduler_average_turnaround_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average response time of all jobs scheduled.
  */
-float scheduler_average_response_time()
+float scheduler_average_response_time_r(scheduler_t *s)
 {
-	  return ((float)total_response_time/(float)jobs_finished);
+	  return ((float)s->total_response_time/(float)s->jobs_finished);
 }
 
 
 /**
-  Free any memory associated with your scheduler.
- 
-  Assumptions:
-    - This function will be the last function called in your library.
+  Frees a scheduler and any jobs it still holds.
+
+  @param s the scheduler from scheduler_create
 */
-void scheduler_clean_up()
+void scheduler_destroy(scheduler_t *s)
 {
-    priqueue_destroy(&job_queue);
+    fifo_queue_destroy(&s->fifo_jobs);
+    sjf_queue_destroy(&s->sjf_jobs);
+    pri_queue_destroy(&s->pri_jobs);
+    pool_destroy(&s->job_pool);//frees any jobs still queued or running too
     int i=0;
-    while(i<num_cores)
+    while(i<s->num_cores)
     {
-        free(core_array[i]);
+        free(s->core_array[i]);
         i++;
     }
-    free(core_array);
+    free(s->core_array);
+    free(s);
 }
 
 
@@ -529,14 +675,116 @@ void scheduler_clean_up()
   makes to your scheduler.
   In our provided output, we have implemented this function to list the jobs in the order they are to be scheduled. Furthermore, we have also listed the current state of the job (either running on a given core or idle). For example, if we have a non-preemptive algorithm and job(id=4) has began running, job(id=2) arrives with a higher priority, and job(id=1) arrives with a lower priority, the output in our sample output will be:
 */
-void scheduler_show_queue()
+void scheduler_show_queue_r(scheduler_t *s)
 {
-    int i = 0;
-    while( priqueue_at( &job_queue, i ) != NULL )
+    struct job_t* data;
+
+    //Walks the queue once; the queues keep their sorted order between calls
+    switch(s->pri_scheme)
     {
-        struct job_t* data = priqueue_at( &job_queue, i );   
-        printf(" [Jn:%d, rt:%d, pri:%d] ->", data->job_number,data->running_time,data->priority );
-        i++;
+        case SJF:
+        case PSJF:
+        {
+            sjf_queue_iter_t it;
+            sjf_queue_iter_init(&it, &s->sjf_jobs);
+            while( sjf_queue_iter_next(&it, &data) )
+            {
+                show_job(data);
+            }
+            break;
+        }
+        case PRI:
+        case PPRI:
+        {
+            pri_queue_iter_t it;
+            pri_queue_iter_init(&it, &s->pri_jobs);
+            while( pri_queue_iter_next(&it, &data) )
+            {
+                show_job(data);
+            }
+            break;
+        }
+        default:
+        {
+            fifo_queue_iter_t it;
+            fifo_queue_iter_init(&it, &s->fifo_jobs);
+            while( fifo_queue_iter_next(&it, &data) )
+            {
+                show_job(data);
+            }
+            break;
+        }
     }
     printf(" [NULL]\n"); 
-}
\ No newline at end of file
+}
+
+
+/*
+  The original single-scheduler API, kept for the simulator. Each call
+  forwards to the _r version on one scheduler created by
+  scheduler_start_up.
+*/
+
+/**
+  Initalizes the scheduler.
+ 
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called once once.
+    - You may assume that cores is a positive, non-zero number.
+    - You may assume that scheme is a valid scheduling scheme.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+    default_scheduler = scheduler_create(cores, scheme);
+}
+
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+    return scheduler_new_job_r(default_scheduler, job_number, time, running_time, priority);
+}
+
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+    return scheduler_job_finished_r(default_scheduler, core_id, job_number, time);
+}
+
+int scheduler_quantum_expired(int core_id, int time)
+{
+    return scheduler_quantum_expired_r(default_scheduler, core_id, time);
+}
+
+float scheduler_average_waiting_time()
+{
+    return scheduler_average_waiting_time_r(default_scheduler);
+}
+
+float scheduler_average_turnaround_time()
+{
+    return scheduler_average_turnaround_time_r(default_scheduler);
+}
+
+float scheduler_average_response_time()
+{
+    return scheduler_average_response_time_r(default_scheduler);
+}
+
+/**
+  Free any memory associated with your scheduler.
+ 
+  Assumptions:
+    - This function will be the last function called in your library.
+*/
+void scheduler_clean_up()
+{
+    scheduler_destroy(default_scheduler);
+    default_scheduler = NULL;
+}
+
+void scheduler_show_queue()
+{
+    scheduler_show_queue_r(default_scheduler);
+}
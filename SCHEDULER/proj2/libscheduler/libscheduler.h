@@ -4,9 +4,11 @@
 #ifndef LIBSCHEDULER_H_
 #define LIBSCHEDULER_H_
 
+#include <stdio.h>
+
 typedef int bool;
-#define true 1;
-#define false 0;
+#define true 1
+#define false 0
 
 /**
   Constants which represent the different scheduling algorithms
@@ -31,6 +33,24 @@ typedef struct core_t
 
 typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
 
+/**
+  One independent scheduler. The _r functions take one explicitly; the
+  others act on a single scheduler set up by scheduler_start_up.
+*/
+typedef struct scheduler_t scheduler_t;
+
+scheduler_t *scheduler_create          (int cores, scheme_t scheme);
+void  scheduler_set_quiet              (scheduler_t *s, bool quiet);
+int   scheduler_set_event_log          (scheduler_t *s, FILE *file);
+int   scheduler_new_job_r              (scheduler_t *s, int job_number, int time, int running_time, int priority);
+int   scheduler_job_finished_r         (scheduler_t *s, int core_id, int job_number, int time);
+int   scheduler_quantum_expired_r      (scheduler_t *s, int core_id, int time);
+float scheduler_average_turnaround_time_r(scheduler_t *s);
+float scheduler_average_waiting_time_r (scheduler_t *s);
+float scheduler_average_response_time_r(scheduler_t *s);
+void  scheduler_show_queue_r           (scheduler_t *s);
+void  scheduler_destroy                (scheduler_t *s);
+
 void  scheduler_start_up               (int cores, scheme_t scheme);
 int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
 int   scheduler_job_finished           (int core_id, int job_number, int time);
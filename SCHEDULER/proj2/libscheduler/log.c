@@ -0,0 +1,105 @@
+/** @file log.c
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+#include "log.h"
+
+/** Messages above this level are dropped; everything is shown by default */
+log_level_t log_level = LOG_DEBUG;
+
+static const char *level_names[] = {"error", "warn", "info", "debug"};
+
+/**
+  Sets which messages are shown from now on.
+
+  @param level the most detailed level to show
+ */
+void log_set_level(log_level_t level)
+{
+    log_level = level;
+}
+
+/**
+  Looks up a level by name: error, warn, info or debug.
+
+  @param name the name, in any case
+  @return the level, or -1 if there is no level by that name
+ */
+int log_parse_level(const char *name)
+{
+    int i;
+
+    for (i = LOG_ERROR; i <= LOG_DEBUG; i++)
+        if (strcasecmp(name, level_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**
+  Writes a log message. Messages go to stdout, in line with the rest of the
+  simulator's output; use LOG so disabled levels cost nothing.
+ */
+void log_printf(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/**
+  Starts a binary event log.
+
+  @param file the log, open for writing
+  @param cores the number of cores of the scheduler being recorded
+  @param scheme the scheme of the scheduler being recorded
+  @return 0 on success, -1 if the header could not be written
+ */
+int log_write_header(FILE *file, int cores, int scheme)
+{
+    log_header_t header;
+
+    memcpy(header.magic, "SCHEDLOG", sizeof(header.magic));
+    header.version = LOG_VERSION;
+    header.cores = cores;
+    header.scheme = scheme;
+    return fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+}
+
+/**
+  Reads the header of a binary event log.
+
+  @param file the log, open for reading at its start
+  @param header where the header is read into
+  @return 0 on success, -1 if the file is not an event log this code reads
+ */
+int log_read_header(FILE *file, log_header_t *header)
+{
+    if (fread(header, sizeof(*header), 1, file) != 1)
+        return -1;
+    if (memcmp(header->magic, "SCHEDLOG", sizeof(header->magic)) != 0 || header->version != LOG_VERSION)
+        return -1;
+    return 0;
+}
+
+/**
+  Appends one event to a binary event log.
+ */
+void log_write_event(FILE *file, const log_event_t *event)
+{
+    fwrite(event, sizeof(*event), 1, file);
+}
+
+/**
+  Reads the next event of a binary event log.
+
+  @return 1 if an event was read, 0 at the end of the log
+ */
+int log_read_event(FILE *file, log_event_t *event)
+{
+    return fread(event, sizeof(*event), 1, file) == 1;
+}
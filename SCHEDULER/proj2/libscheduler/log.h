@@ -0,0 +1,78 @@
+/** @file log.h
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+  How much the scheduler and the simulator say. Each level includes the
+  ones above it.
+*/
+typedef enum {LOG_ERROR = 0, LOG_WARN, LOG_INFO, LOG_DEBUG} log_level_t;
+
+/**
+  The most detailed level compiled in. Building with, say,
+  -DLOG_MAX_LEVEL=LOG_WARN removes every LOG_INFO and LOG_DEBUG message
+  along with the work of formatting it.
+*/
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_DEBUG
+#endif
+
+extern log_level_t log_level;
+
+#define LOG_ENABLED(level) ((level) <= LOG_MAX_LEVEL && (level) <= log_level)
+
+#define LOG(level, ...)                                                       \
+    do                                                                        \
+    {                                                                         \
+        if (LOG_ENABLED(level))                                               \
+            log_printf(__VA_ARGS__);                                          \
+    } while (0)
+
+void log_set_level   (log_level_t level);
+int  log_parse_level (const char *name);
+void log_printf      (const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+  The start of a binary event log: the magic "SCHEDLOG", the format
+  version and the scheduler the events were recorded from. Everything is
+  in the recording machine's byte order.
+*/
+typedef struct log_header_t
+{
+  char magic[8];
+  uint32_t version;
+  int32_t cores;
+  int32_t scheme;
+} log_header_t;
+
+typedef enum {LOG_EVENT_ARRIVAL = 0, LOG_EVENT_FINISHED, LOG_EVENT_EXPIRED} log_event_type_t;
+
+/**
+  One scheduler call in a binary event log, with the answer the scheduler
+  gave. job is -1 for an expired quantum and core is -1 for an arrival;
+  running_time and priority are only set for arrivals.
+*/
+typedef struct log_event_t
+{
+  int32_t type;
+  int32_t time;
+  int32_t job;
+  int32_t core;
+  int32_t running_time;
+  int32_t priority;
+  int32_t decision;
+} log_event_t;
+
+#define LOG_VERSION 1
+
+int  log_write_header (FILE *file, int cores, int scheme);
+int  log_read_header  (FILE *file, log_header_t *header);
+void log_write_event  (FILE *file, const log_event_t *event);
+int  log_read_event   (FILE *file, log_event_t *event);
+
+#endif /* LOG_H_ */
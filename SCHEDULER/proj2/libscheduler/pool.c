@@ -0,0 +1,109 @@
+/** @file pool.c
+ */
+
+#include <stdlib.h>
+
+#include "pool.h"
+
+/**
+  Initializes an empty pool. No memory is taken until the first object is
+  allocated.
+
+  @param pool a pointer to an instance of the pool_t data structure
+  @param object_size the size of every object the pool hands out
+  @param per_chunk how many objects to allocate from the system at a time
+ */
+void pool_init(pool_t *pool, size_t object_size, int per_chunk)
+{
+    //Freed objects have to be able to hold the free list link
+    if(object_size < sizeof(void *))
+    {
+        object_size = sizeof(void *);
+    }
+    object_size = (object_size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+
+    pool->object_size = object_size;
+    pool->per_chunk = per_chunk > 0 ? per_chunk : 1;
+    pool->chunks = NULL;
+    pool->num_chunks = 0;
+    pool->chunk_capacity = 0;
+    pool->used_in_chunk = 0;
+    pool->free_list = NULL;
+}
+
+/**
+  Takes an object from the pool. Its contents are undefined.
+
+  @param pool a pointer to an instance of the pool_t data structure
+  @return the object
+  @return NULL if memory ran out
+ */
+void *pool_alloc(pool_t *pool)
+{
+    if(pool->free_list != NULL)
+    {
+        void *object = pool->free_list;
+        pool->free_list = *(void **)object;
+        return object;
+    }
+
+    if(pool->num_chunks == 0 || pool->used_in_chunk == pool->per_chunk)
+    {
+        if(pool->num_chunks == pool->chunk_capacity)
+        {
+            int capacity = pool->chunk_capacity ? pool->chunk_capacity * 2 : 8;
+            char **chunks = realloc(pool->chunks, capacity * sizeof(char *));
+            if(chunks == NULL)
+            {
+                return NULL;
+            }
+            pool->chunks = chunks;
+            pool->chunk_capacity = capacity;
+        }
+
+        char *chunk = malloc(pool->object_size * pool->per_chunk);
+        if(chunk == NULL)
+        {
+            return NULL;
+        }
+        pool->chunks[pool->num_chunks++] = chunk;
+        pool->used_in_chunk = 0;
+    }
+
+    return pool->chunks[pool->num_chunks - 1] + pool->object_size * pool->used_in_chunk++;
+}
+
+/**
+  Returns an object to the pool so it can be handed out again.
+
+  @param pool a pointer to an instance of the pool_t data structure
+  @param object an object from pool_alloc on the same pool, or NULL
+ */
+void pool_free(pool_t *pool, void *object)
+{
+    if(object == NULL)
+    {
+        return;
+    }
+
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+}
+
+/**
+  Frees every object the pool has handed out, whether or not it was
+  returned with pool_free.
+
+  @param pool a pointer to an instance of the pool_t data structure
+ */
+void pool_destroy(pool_t *pool)
+{
+    int i;
+    for(i = 0; i < pool->num_chunks; i++)
+    {
+        free(pool->chunks[i]);
+    }
+    free(pool->chunks);
+
+    pool_init(pool, pool->object_size, pool->per_chunk);
+}
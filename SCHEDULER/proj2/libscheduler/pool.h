@@ -0,0 +1,35 @@
+/** @file pool.h
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+
+/**
+  Pool of fixed-size objects carved out of large chunks.
+
+  Freed objects go on a free list threaded through their own storage and
+  are handed out again first, so alloc and free are O(1) and live objects
+  stay close together. Everything is released at once by pool_destroy.
+*/
+typedef struct pool_t
+{
+    size_t object_size;
+    int per_chunk;
+
+    char **chunks;
+    int num_chunks;
+    int chunk_capacity;
+    int used_in_chunk;
+
+    void *free_list;
+
+} pool_t;
+
+void   pool_init    (pool_t *pool, size_t object_size, int per_chunk);
+void * pool_alloc   (pool_t *pool);
+void   pool_free    (pool_t *pool, void *object);
+void   pool_destroy (pool_t *pool);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,183 @@
+/** @file diagram.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diagram.h"
+
+/**
+  Initializes an empty diagram.
+
+  @param diagram a pointer to an instance of the diagram_t data structure
+  @param cores the number of rows
+ */
+void diagram_init(diagram_t *diagram, int cores)
+{
+    diagram->cores = cores;
+    diagram->rows = calloc(cores, sizeof(diagram_row_t));
+}
+
+/**
+  Records a job running on a core from start for length time units. Time
+  units have to be added to a row in order; a run that carries on from
+  the row's last segment with the same job is merged into it.
+
+  @param diagram the diagram
+  @param core_id the core the job ran on
+  @param job the job's number
+  @param start the first time unit the job ran
+  @param length how many time units it ran
+ */
+void diagram_add(diagram_t *diagram, int core_id, int job, int start, int length)
+{
+    diagram_row_t *row = &diagram->rows[core_id];
+
+    if (length <= 0)
+        return;
+
+    if (row->num_segments > 0)
+    {
+        diagram_segment_t *last = &row->segments[row->num_segments - 1];
+        if (last->job == job && last->start + last->length == start)
+        {
+            last->length += length;
+            return;
+        }
+    }
+
+    if (row->num_segments == row->capacity)
+    {
+        row->capacity = row->capacity ? row->capacity * 2 : 16;
+        row->segments = realloc(row->segments, row->capacity * sizeof(diagram_segment_t));
+    }
+
+    row->segments[row->num_segments].job = job;
+    row->segments[row->num_segments].start = start;
+    row->segments[row->num_segments].length = length;
+    row->num_segments++;
+}
+
+/** The characters simulator.c has always shown a job as */
+static int job_label(int job, char *label)
+{
+    if (job < 10)
+        return sprintf(label, "%d", job);
+    else if (job < 10 + 26)
+        return sprintf(label, "%c", job - 10 + 'a');
+    else if (job < 10 + 26 + 26)
+        return sprintf(label, "%c", job - 10 - 26 + 'A');
+    return sprintf(label, "(%d)", job);
+}
+
+static void print_repeated(const char *text, int len, int times, FILE *file)
+{
+    while (times-- > 0)
+        fwrite(text, 1, len, file);
+}
+
+/**
+  Renders one core's row of time units 0 to end - 1 the way simulator.c
+  prints it: a character per time unit for the job that ran, '-' when the
+  core was idle.
+
+  @param diagram the diagram
+  @param core_id the row to print
+  @param end the time unit to stop at
+  @param file where the row is printed
+ */
+void diagram_print_row(const diagram_t *diagram, int core_id, int end, FILE *file)
+{
+    const diagram_row_t *row = &diagram->rows[core_id];
+    char label[16];
+    int time = 0, i;
+
+    for (i = 0; i < row->num_segments && time < end; i++)
+    {
+        const diagram_segment_t *segment = &row->segments[i];
+        int stop = segment->start + segment->length < end ? segment->start + segment->length : end;
+
+        print_repeated("-", 1, segment->start - time, file);
+        print_repeated(label, job_label(segment->job, label), stop - segment->start, file);
+        time = stop;
+    }
+    print_repeated("-", 1, end - time, file);
+}
+
+/**
+  Writes the diagram in its binary form; see diagram_header_t.
+
+  @param diagram the diagram
+  @param end the length of the simulation
+  @param file where the diagram is written, open for writing
+  @return 0 on success, -1 if the file could not be written
+ */
+int diagram_write_binary(const diagram_t *diagram, int end, FILE *file)
+{
+    diagram_header_t header;
+    int i;
+
+    memcpy(header.magic, "SCHEDDGM", sizeof(header.magic));
+    header.version = DIAGRAM_VERSION;
+    header.cores = diagram->cores;
+    header.length = end;
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        return -1;
+
+    for (i = 0; i < diagram->cores; i++)
+    {
+        const diagram_row_t *row = &diagram->rows[i];
+        int32_t num_segments = row->num_segments;
+
+        if (fwrite(&num_segments, sizeof(num_segments), 1, file) != 1
+            || fwrite(row->segments, sizeof(diagram_segment_t), row->num_segments, file) != (size_t)row->num_segments)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+  Writes the diagram as Chrome trace event JSON, which chrome://tracing and
+  Perfetto open: a track per core and a complete event per segment, with
+  one time unit shown as one microsecond.
+
+  @param diagram the diagram
+  @param file where the JSON is written, open for writing
+  @return 0 on success, -1 if the file could not be written
+ */
+int diagram_write_chrome(const diagram_t *diagram, FILE *file)
+{
+    int i, j;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (i = 0; i < diagram->cores; i++)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"Core %d\"}}",
+                i ? ",\n" : "", i, i);
+    }
+    for (i = 0; i < diagram->cores; i++)
+    {
+        const diagram_row_t *row = &diagram->rows[i];
+
+        for (j = 0; j < row->num_segments; j++)
+        {
+            const diagram_segment_t *segment = &row->segments[j];
+            fprintf(file, ",\n{\"name\":\"job %d\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%d,\"dur\":%d}",
+                    segment->job, i, segment->start, segment->length);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return ferror(file) ? -1 : 0;
+}
+
+/**
+  Frees the diagram's rows.
+ */
+void diagram_destroy(diagram_t *diagram)
+{
+    int i;
+
+    for (i = 0; i < diagram->cores; i++)
+        free(diagram->rows[i].segments);
+    free(diagram->rows);
+}
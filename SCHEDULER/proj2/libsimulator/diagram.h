@@ -0,0 +1,64 @@
+/** @file diagram.h
+ */
+
+#ifndef DIAGRAM_H_
+#define DIAGRAM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+  A stretch of time one job spent on a core. Idle time is not stored; it
+  is whatever lies between segments.
+*/
+typedef struct diagram_segment_t
+{
+  int32_t job;
+  int32_t start;
+  int32_t length;
+} diagram_segment_t;
+
+typedef struct diagram_row_t
+{
+  diagram_segment_t *segments;
+  int num_segments;
+  int capacity;
+} diagram_row_t;
+
+/**
+  The timing diagram of a simulation, one run-length encoded row per core.
+
+  Adding a time unit to a row is O(1): it either lengthens the row's last
+  segment or starts a new one. Rows are only turned into text, or written
+  out, when asked for.
+*/
+typedef struct diagram_t
+{
+  int cores;
+  diagram_row_t *rows;
+} diagram_t;
+
+/**
+  The start of a binary diagram: the magic "SCHEDDGM", the format version,
+  the number of cores and the diagram's length. Each core follows as its
+  number of segments and then the segments. Everything is in the writing
+  machine's byte order.
+*/
+typedef struct diagram_header_t
+{
+  char magic[8];
+  uint32_t version;
+  int32_t cores;
+  int32_t length;
+} diagram_header_t;
+
+#define DIAGRAM_VERSION 1
+
+void diagram_init         (diagram_t *diagram, int cores);
+void diagram_add          (diagram_t *diagram, int core_id, int job, int start, int length);
+void diagram_print_row    (const diagram_t *diagram, int core_id, int end, FILE *file);
+int  diagram_write_binary (const diagram_t *diagram, int end, FILE *file);
+int  diagram_write_chrome (const diagram_t *diagram, FILE *file);
+void diagram_destroy      (diagram_t *diagram);
+
+#endif /* DIAGRAM_H_ */
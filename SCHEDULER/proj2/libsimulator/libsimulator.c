@@ -0,0 +1,677 @@
+/** @file libsimulator.c
+
+  Runs a trace through a scheduler and reports the metrics, the way
+  simulator.c does with its output left out. The caller creates the
+  scheduler, so it can quiet it or have it record an event log first.
+
+  simulator_run_ticks follows simulator.c's main loop, one time unit at a
+  time. simulator_run reaches the same results by jumping from one event
+  to the next: arrivals, completions and quantum expiries wait in a queue
+  ordered by time, so stretches where nothing happens cost nothing and
+  each event costs O(log n) instead of a scan over every job.
+
+  simulator_run_source takes jobs one at a time, in order of arrival, as
+  they are due, so a trace read from a file never has to be in memory all
+  at once; simulator_run feeds it a trace held in an array.
+
+  Both engines make the scheduler calls of a time unit in the order
+  simulator.c does: completions, then quantum expiries by core, then
+  arrivals. Completions and arrivals at the same time are taken in the
+  order of simulator.c's job array, which changes as finished jobs are
+  swapped out of it, so the event engine keeps that array too.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libsimulator.h"
+#include "../libpriqueue/priqueue_define.h"
+
+typedef enum {COMPLETION = 0, EXPIRY, ARRIVAL} event_type_t;
+
+/**
+  Something due to happen at time. Completions and expiries name the core
+  and the stamp the core had when its job was placed on it; if the stamp
+  has moved on since, the job left the core early and the event is
+  dropped. One arrival event stands for every job arriving at its time.
+*/
+typedef struct event_t
+{
+    int time;
+    event_type_t type;
+    int core_id;
+    unsigned int stamp;
+} event_t;
+
+PRIQUEUE_DEFINE(event_queue, event_t, (long long)x.time * 4 + x.type)
+
+/** A job and the value it is sorted by */
+typedef struct job_ref_t
+{
+    int key;
+    int job;
+} job_ref_t;
+
+/** A job arriving and its place in the job array */
+typedef struct arrival_t
+{
+    int pos;
+    simulator_job_t job;
+} arrival_t;
+
+typedef struct sim_core_t
+{
+    int job;
+    int started;
+    unsigned int stamp;
+} sim_core_t;
+
+/**
+  The state of one event driven simulation. jobs[] is simulator.c's job
+  array, every job that has not finished in the order simulator.c keeps
+  them; pos[] gives each job's index in it, or -1 once the job is done.
+*/
+typedef struct sim_t
+{
+    scheduler_t *s;
+    simulator_source_t *source;
+    int num_jobs;
+    scheme_t scheme;
+    int quantum;
+    int num_cores;
+    sim_core_t *cores;
+    int running;
+    event_queue_t events;
+
+    int *jobs;
+    int *pos;
+    int active_jobs;
+    int jobs_alive;
+    int *remaining;
+    int *core_of;
+    char *arrived;
+
+    simulator_job_t next_arrival;
+    int has_next_arrival;
+    arrival_t *batch;
+    int batch_capacity;
+    long long busy;
+    diagram_t *diagram;
+} sim_t;
+
+static int compare_arrivals(const void *a, const void *b)
+{
+    const arrival_t *arrival1 = a;
+    const arrival_t *arrival2 = b;
+
+    return arrival1->pos - arrival2->pos;
+}
+
+static int compare_refs(const void *a, const void *b)
+{
+    const job_ref_t *ref1 = a;
+    const job_ref_t *ref2 = b;
+
+    if (ref1->key != ref2->key)
+        return ref1->key < ref2->key ? -1 : 1;
+    return ref1->job - ref2->job;
+}
+
+static void push_event(sim_t *sim, int time, event_type_t type, int core_id)
+{
+    event_t event;
+
+    event.time = time;
+    event.type = type;
+    event.core_id = core_id;
+    event.stamp = core_id >= 0 ? sim->cores[core_id].stamp : 0;
+    event_queue_offer(&sim->events, event);
+}
+
+/**
+  Takes a core's job off it at time, keeping what is left of the job's run.
+*/
+static void stop_job(sim_t *sim, int core_id, int time)
+{
+    sim_core_t *core = &sim->cores[core_id];
+    int ran = time - core->started;
+
+    sim->remaining[core->job] -= ran;
+    sim->busy += ran;
+    if (sim->diagram != NULL)
+        diagram_add(sim->diagram, core_id, core->job, core->started, ran);
+    sim->core_of[core->job] = -1;
+    sim->running--;
+    core->job = -1;
+    core->stamp++;
+}
+
+/**
+  Puts a job on a core at time, taking off whatever job the core had, and
+  queues the job's completion and, under RR, its quantum expiry. A job
+  moved from another core leaves that core idle, as it does in
+  simulator.c.
+*/
+static void start_job(sim_t *sim, int job, int core_id, int time)
+{
+    sim_core_t *core = &sim->cores[core_id];
+
+    if (sim->core_of[job] != -1)
+        stop_job(sim, sim->core_of[job], time);
+    if (core->job != -1)
+        stop_job(sim, core_id, time);
+
+    core->job = job;
+    core->started = time;
+    core->stamp++;
+    sim->core_of[job] = core_id;
+    sim->running++;
+
+    push_event(sim, time + sim->remaining[job], COMPLETION, core_id);
+    if (sim->scheme == RR)
+        push_event(sim, time + sim->quantum, EXPIRY, core_id);
+}
+
+/**
+  Gives a core to the job the scheduler chose for it, if any.
+
+  @return 0, or 3 if the job chosen has not arrived or has finished
+*/
+static int assign_job(sim_t *sim, int job, int core_id, int time)
+{
+    if (job == -1)
+        return 0;
+    if (job < 0 || job >= sim->num_jobs || sim->pos[job] == -1 || !sim->arrived[job])
+        return 3;
+    start_job(sim, job, core_id, time);
+    return 0;
+}
+
+/** Drops a finished job from the job array the way simulator.c does */
+static void remove_job(sim_t *sim, int job)
+{
+    int i = sim->pos[job];
+    int last = sim->jobs[--sim->active_jobs];
+
+    sim->jobs[i] = last;
+    sim->pos[last] = i;
+    sim->pos[job] = -1;
+}
+
+/**
+  Reports the jobs in finished[] done, in the order simulator.c's scan of
+  its job array reaches them: lowest index first, and the same index again
+  after a job is swapped into it. There is at most one job per core, so
+  finding the lowest each time is cheap.
+*/
+static int finish_jobs(sim_t *sim, int *finished, int n, int time)
+{
+    while (n > 0)
+    {
+        int lowest = 0, i;
+
+        for (i = 1; i < n; i++)
+            if (sim->pos[finished[i]] < sim->pos[finished[lowest]])
+                lowest = i;
+
+        int job = finished[lowest];
+        int core_id = sim->core_of[job];
+        finished[lowest] = finished[--n];
+
+        int new_job = scheduler_job_finished_r(sim->s, core_id, job, time);
+        stop_job(sim, core_id, time);
+        remove_job(sim, job);
+        sim->jobs_alive--;
+
+        if (assign_job(sim, new_job, core_id, time))
+            return 3;
+    }
+    return 0;
+}
+
+static int expire_quantum(sim_t *sim, int core_id, int time)
+{
+    int new_job = scheduler_quantum_expired_r(sim->s, core_id, time);
+
+    stop_job(sim, core_id, time);
+    return assign_job(sim, new_job, core_id, time);
+}
+
+/**
+  Takes the next job from the source.
+
+  @return 0, or 2 if the source failed or gave a job out of order
+*/
+static int pull_arrival(sim_t *sim, int time)
+{
+    int got = sim->source->next(sim->source->context, &sim->next_arrival);
+
+    sim->has_next_arrival = got == 1;
+    if (got < 0)
+        return 2;
+    if (got == 0)
+        return 0;
+    if (sim->next_arrival.job_id < 0 || sim->next_arrival.job_id >= sim->num_jobs
+        || sim->next_arrival.arrival_time < time || sim->next_arrival.run_time <= 0)
+        return 2;
+    return 0;
+}
+
+/**
+  Hands every job arriving at time to the scheduler, in job array order,
+  and queues the next arrival.
+*/
+static int arrive_jobs(sim_t *sim, int time)
+{
+    int n = 0, i, status;
+
+    while (sim->has_next_arrival && sim->next_arrival.arrival_time == time)
+    {
+        if (n == sim->batch_capacity)
+        {
+            arrival_t *batch = realloc(sim->batch, 2 * sim->batch_capacity * sizeof(arrival_t));
+
+            if (batch == NULL)
+                return 4;
+            sim->batch = batch;
+            sim->batch_capacity *= 2;
+        }
+        sim->batch[n].pos = sim->pos[sim->next_arrival.job_id];
+        sim->batch[n++].job = sim->next_arrival;
+
+        if ((status = pull_arrival(sim, time)) != 0)
+            return status;
+    }
+    if (sim->has_next_arrival)
+        push_event(sim, sim->next_arrival.arrival_time, ARRIVAL, -1);
+    if (n > 1)
+        qsort(sim->batch, n, sizeof(arrival_t), compare_arrivals);
+
+    for (i = 0; i < n; i++)
+    {
+        const simulator_job_t *arriving = &sim->batch[i].job;
+        int job = arriving->job_id;
+        int core_id = scheduler_new_job_r(sim->s, job, time, arriving->run_time, arriving->priority);
+
+        sim->arrived[job] = 1;
+        sim->remaining[job] = arriving->run_time;
+        sim->jobs_alive++;
+
+        if (core_id >= 0 && core_id < sim->num_cores)
+            start_job(sim, job, core_id, time);
+        else if (core_id != -1)
+            return 3;
+    }
+    return 0;
+}
+
+static void fill_result(simulator_result_t *result, scheduler_t *s, int status, int makespan, long long busy)
+{
+    result->status = status;
+    result->makespan = makespan;
+    result->busy = busy;
+    result->waiting = scheduler_average_waiting_time_r(s);
+    result->turnaround = scheduler_average_turnaround_time_r(s);
+    result->response = scheduler_average_response_time_r(s);
+}
+
+/** Feeds simulator_run_source a trace held in memory */
+typedef struct array_source_t
+{
+    job_ref_t *by_arrival;
+    const simulator_job_t *jobs;
+    int next;
+    int num_jobs;
+} array_source_t;
+
+static int next_from_array(void *context, simulator_job_t *job)
+{
+    array_source_t *array = context;
+
+    if (array->next == array->num_jobs)
+        return 0;
+    *job = array->jobs[array->by_arrival[array->next++].job];
+    return 1;
+}
+
+/**
+  Simulates a trace held in memory by jumping from event to event. The
+  trace can be in any order.
+
+  @param s a scheduler fresh from scheduler_create(cores, scheme)
+  @param jobs the trace, with job_id i at index i
+  @param num_jobs the number of jobs in the trace
+  @param cores the number of cores to schedule on
+  @param scheme the scheduling scheme
+  @param quantum the RR quantum; ignored by the other schemes
+  @param diagram an empty diagram with a row per core to record the
+                 schedule in, or NULL
+  @param result where the metrics are written
+ */
+void simulator_run(scheduler_t *s, const simulator_job_t *jobs, int num_jobs, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result)
+{
+    array_source_t array;
+    simulator_source_t source;
+    int i;
+
+    array.by_arrival = malloc(num_jobs * sizeof(job_ref_t));
+    if (array.by_arrival == NULL)
+    {
+        fill_result(result, s, 4, 0, 0);
+        return;
+    }
+    array.jobs = jobs;
+    array.next = 0;
+    array.num_jobs = num_jobs;
+    for (i = 0; i < num_jobs; i++)
+    {
+        array.by_arrival[i].key = jobs[i].arrival_time;
+        array.by_arrival[i].job = i;
+    }
+    qsort(array.by_arrival, num_jobs, sizeof(job_ref_t), compare_refs);
+
+    source.num_jobs = num_jobs;
+    source.next = next_from_array;
+    source.context = &array;
+    simulator_run_source(s, &source, cores, scheme, quantum, diagram, result);
+
+    free(array.by_arrival);
+}
+
+/**
+  Simulates jobs taken from a source by jumping from event to event. Jobs
+  are only asked for when the one before them arrives, so the engine
+  holds a few words per job but never the trace.
+
+  A source that fails, or gives jobs out of order of arrival, ends the
+  simulation with status 2, and running out of memory with status 4.
+
+  @param s a scheduler fresh from scheduler_create(cores, scheme)
+  @param source where the jobs come from
+  @param cores the number of cores to schedule on
+  @param scheme the scheduling scheme
+  @param quantum the RR quantum; ignored by the other schemes
+  @param diagram an empty diagram with a row per core to record the
+                 schedule in, or NULL
+  @param result where the metrics are written
+ */
+void simulator_run_source(scheduler_t *s, simulator_source_t *source, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result)
+{
+    int num_jobs = source->num_jobs;
+    sim_t sim;
+    int *finished = malloc(cores * sizeof(int));
+    event_t *expired = malloc(cores * sizeof(event_t));
+    int status = 0, time = 0, i;
+
+    memset(&sim, 0, sizeof(sim));
+    sim.s = s;
+    sim.source = source;
+    sim.num_jobs = num_jobs;
+    sim.scheme = scheme;
+    sim.quantum = quantum;
+    sim.num_cores = cores;
+    sim.diagram = diagram;
+    sim.cores = malloc(cores * sizeof(sim_core_t));
+    sim.jobs = malloc(num_jobs * sizeof(int));
+    sim.pos = malloc(num_jobs * sizeof(int));
+    sim.remaining = malloc(num_jobs * sizeof(int));
+    sim.core_of = malloc(num_jobs * sizeof(int));
+    sim.arrived = calloc(num_jobs, 1);
+    sim.batch_capacity = 16;
+    sim.batch = malloc(sim.batch_capacity * sizeof(arrival_t));
+    sim.active_jobs = num_jobs;
+    event_queue_init(&sim.events);
+
+    if (finished == NULL || expired == NULL || sim.cores == NULL || sim.jobs == NULL || sim.pos == NULL
+        || sim.remaining == NULL || sim.core_of == NULL || sim.arrived == NULL || sim.batch == NULL)
+        status = 4;
+    else
+    {
+        for (i = 0; i < cores; i++)
+        {
+            sim.cores[i].job = -1;
+            sim.cores[i].stamp = 0;
+        }
+        for (i = 0; i < num_jobs; i++)
+        {
+            sim.jobs[i] = i;
+            sim.pos[i] = i;
+            sim.core_of[i] = -1;
+        }
+        status = pull_arrival(&sim, 0);
+        if (sim.has_next_arrival)
+            push_event(&sim, sim.next_arrival.arrival_time, ARRIVAL, -1);
+    }
+
+    while (sim.active_jobs > 0 && status == 0)
+    {
+        event_t event;
+        int num_finished = 0, num_expired = 0, arrivals = 0;
+
+        // Nothing left to happen with jobs still waiting: they would never run
+        if (!event_queue_peek(&sim.events, &event))
+        {
+            status = 3;
+            break;
+        }
+        time = event.time;
+
+        while (event_queue_peek(&sim.events, &event) && event.time == time)
+        {
+            event_queue_poll(&sim.events, &event);
+            if (event.type == ARRIVAL)
+                arrivals = 1;
+            else if (event.stamp != sim.cores[event.core_id].stamp)
+                continue;
+            else if (event.type == COMPLETION)
+                finished[num_finished++] = sim.cores[event.core_id].job;
+            else
+                expired[num_expired++] = event;
+        }
+
+        if ((status = finish_jobs(&sim, finished, num_finished, time)) != 0)
+            break;
+        if (sim.active_jobs == 0)
+            break;
+
+        // Expiries are taken by core; a job that also finished now is gone
+        for (i = 1; i < num_expired; i++)
+        {
+            event_t tmp = expired[i];
+            int j = i;
+            for (; j > 0 && expired[j - 1].core_id > tmp.core_id; j--)
+                expired[j] = expired[j - 1];
+            expired[j] = tmp;
+        }
+        for (i = 0; i < num_expired && status == 0; i++)
+            if (expired[i].stamp == sim.cores[expired[i].core_id].stamp)
+                status = expire_quantum(&sim, expired[i].core_id, time);
+
+        if (status == 0 && arrivals)
+            status = arrive_jobs(&sim, time);
+
+        // All cores idle with a job waiting means the scheduler failed
+        if (status == 0 && sim.jobs_alive > 0 && sim.running == 0)
+            status = 3;
+        if (status != 0)
+            break;
+    }
+
+    fill_result(result, sim.s, status, time, sim.busy);
+
+    event_queue_destroy(&sim.events);
+    free(sim.cores);
+    free(sim.jobs);
+    free(sim.pos);
+    free(sim.remaining);
+    free(sim.core_of);
+    free(sim.arrived);
+    free(sim.batch);
+    free(finished);
+    free(expired);
+}
+
+
+/** A job in simulator_run_ticks, with simulator.c's bookkeeping */
+typedef struct tick_job_t
+{
+    int job_id, arrival_time, run_time, priority;
+    int core_id, arrived;
+} tick_job_t;
+
+static int set_active_job(int job_id, int core_id, tick_job_t *jobs, int active_jobs)
+{
+    int i;
+    for (i = 0; i < active_jobs; i++)
+    {
+        if (jobs[i].job_id == job_id && jobs[i].arrived)
+        {
+            jobs[i].core_id = core_id;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+  Simulates a trace one time unit at a time, following the main loop of
+  simulator.c step for step. Takes the same arguments as simulator_run and
+  gives the same results; it is kept as the reference simulator_run is
+  checked against.
+ */
+void simulator_run_ticks(scheduler_t *s, const simulator_job_t *trace, int num_jobs, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result)
+{
+    int active_jobs = num_jobs, jobs_alive = 0;
+    int time = 0, status = 0, i, j;
+    long long busy = 0;
+
+    tick_job_t *jobs = malloc(num_jobs * sizeof(tick_job_t));
+    int *quantum_clock = malloc(cores * sizeof(int));
+
+    if (jobs == NULL || quantum_clock == NULL)
+    {
+        fill_result(result, s, 4, 0, 0);
+        free(quantum_clock);
+        free(jobs);
+        return;
+    }
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        jobs[i].job_id = trace[i].job_id;
+        jobs[i].arrival_time = trace[i].arrival_time;
+        jobs[i].run_time = trace[i].run_time;
+        jobs[i].priority = trace[i].priority;
+        jobs[i].core_id = -1;
+        jobs[i].arrived = 0;
+    }
+    for (i = 0; i < cores; i++)
+        quantum_clock[i] = -1;
+
+    while (active_jobs > 0 && status == 0)
+    {
+        /* 1. Jobs that finished in the last time unit */
+        for (i = 0; i < active_jobs; i++)
+        {
+            if (jobs[i].run_time == 0)
+            {
+                int core_id = jobs[i].core_id;
+                int new_job_id = scheduler_job_finished_r(s, core_id, jobs[i].job_id, time);
+
+                if (scheme == RR)
+                    quantum_clock[core_id] = quantum;
+
+                if (i != active_jobs - 1)
+                    memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(tick_job_t));
+                active_jobs--;
+                jobs_alive--;
+                i--;
+
+                if (new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs))
+                    status = 3;
+            }
+        }
+
+        if (active_jobs == 0 || status != 0)
+            break;
+
+        /* 2. Quantums that expired in the last time unit */
+        if (scheme == RR)
+        {
+            for (i = 0; i < cores; i++)
+            {
+                if (quantum_clock[i] != 0)
+                    continue;
+
+                for (j = 0; j < active_jobs; j++)
+                {
+                    if (jobs[j].core_id == i)
+                    {
+                        int new_job_id = scheduler_quantum_expired_r(s, i, time);
+
+                        jobs[j].core_id = -1;
+                        quantum_clock[i] = quantum;
+
+                        if (new_job_id != -1 && !set_active_job(new_job_id, i, jobs, active_jobs))
+                            status = 3;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /* 3. Jobs that arrive in this time unit */
+        for (i = 0; i < active_jobs; i++)
+        {
+            if (jobs[i].arrival_time == time)
+            {
+                int new_job_core_id = scheduler_new_job_r(s, jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
+                jobs[i].arrived = 1;
+                jobs_alive++;
+
+                if (new_job_core_id >= 0 && new_job_core_id < cores)
+                {
+                    for (j = 0; j < active_jobs; j++)
+                        if (jobs[j].core_id == new_job_core_id)
+                            jobs[j].core_id = -1;
+
+                    jobs[i].core_id = new_job_core_id;
+
+                    if (scheme == RR)
+                        quantum_clock[new_job_core_id] = quantum;
+                }
+                else if (new_job_core_id != -1)
+                    status = 3;
+            }
+        }
+
+        /* 4. Run the time unit */
+        int cores_working = 0;
+
+        for (i = 0; i < active_jobs; i++)
+        {
+            if (jobs[i].core_id != -1)
+            {
+                cores_working++;
+                jobs[i].run_time--;
+                quantum_clock[jobs[i].core_id]--;
+
+                if (diagram != NULL)
+                    diagram_add(diagram, jobs[i].core_id, jobs[i].job_id, time, 1);
+            }
+        }
+        busy += cores_working;
+
+        /* 6. All cores idle with a job waiting means the scheduler failed */
+        if (jobs_alive > 0 && cores_working == 0)
+            status = 3;
+
+        time++;
+    }
+
+    fill_result(result, s, status, time, busy);
+
+    free(quantum_clock);
+    free(jobs);
+}
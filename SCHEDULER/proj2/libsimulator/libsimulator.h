@@ -0,0 +1,48 @@
+/** @file libsimulator.h
+ */
+
+#ifndef LIBSIMULATOR_H_
+#define LIBSIMULATOR_H_
+
+#include "../libscheduler/libscheduler.h"
+#include "diagram.h"
+
+/**
+  One line of a trace. job_id is the job's position in the trace.
+*/
+typedef struct simulator_job_t
+{
+  int job_id, arrival_time, run_time, priority;
+} simulator_job_t;
+
+/**
+  What a simulation measured. status is 0 when it ran to the end, 2 when
+  its jobs could not be read, 3 when the scheduler made a choice the
+  simulator rejects and 4 when there was not enough memory to run it, as
+  simulator.c exits with. busy counts time units cores spent running jobs.
+*/
+typedef struct simulator_result_t
+{
+  int status;
+  float waiting, turnaround, response;
+  int makespan;
+  long long busy;
+} simulator_result_t;
+
+/**
+  Jobs for simulator_run_source. next fills in the next job in order of
+  arrival and returns 1, returns 0 when there are no more and -1 if the
+  jobs could not be read. job_ids run from 0 to num_jobs - 1.
+*/
+typedef struct simulator_source_t
+{
+  int num_jobs;
+  int (*next)(void *context, simulator_job_t *job);
+  void *context;
+} simulator_source_t;
+
+void simulator_run       (scheduler_t *s, const simulator_job_t *jobs, int num_jobs, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result);
+void simulator_run_source(scheduler_t *s, simulator_source_t *source, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result);
+void simulator_run_ticks (scheduler_t *s, const simulator_job_t *jobs, int num_jobs, int cores, scheme_t scheme, int quantum, diagram_t *diagram, simulator_result_t *result);
+
+#endif /* LIBSIMULATOR_H_ */
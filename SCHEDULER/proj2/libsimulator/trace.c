@@ -0,0 +1,450 @@
+/** @file trace.c
+
+  Reads and writes traces. A trace is either in the simulator's CSV
+  format: a header line, then one "arrival time,run time,priority" line
+  per job, job i on the i-th line; or in one of the binary formats
+  described in trace.h.
+
+  The file is mapped rather than read. CSV is parsed in place by a
+  scanner that reads each integer digit by digit and checks each line has
+  exactly three columns; counting the lines first, which is a memchr over
+  the mapping, sizes jobs[] once instead of growing it. Binary traces say
+  how many jobs they have, and TRACE_BINARY records are read as they lie
+  in the mapping, with nothing to parse.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+static const char trace_magic[8] = {'S', 'C', 'H', 'E', 'D', 'T', 'R', 'C'};
+
+static uint32_t get_le32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(unsigned char *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static int open_error(trace_t *trace, const char *what)
+{
+    snprintf(trace->error, sizeof(trace->error), "\"%s\" %s.", trace->name, what);
+    return -1;
+}
+
+/**
+  Reads the header of a binary trace and checks the file holds as much as
+  the header says.
+ */
+static int open_binary(trace_t *trace)
+{
+    const unsigned char *header = (const unsigned char *)trace->map;
+    uint32_t version = get_le32(header + 8);
+    uint32_t format = get_le32(header + 12);
+    uint32_t num_jobs = get_le32(header + 16);
+
+    if (version != TRACE_VERSION)
+        return open_error(trace, "is in a trace format version this program does not read");
+    if (format != TRACE_BINARY && format != TRACE_VARINT)
+        return open_error(trace, "is in an unknown trace format");
+    if (num_jobs > INT_MAX)
+        return open_error(trace, "has too many jobs");
+    if (format == TRACE_BINARY && trace->size != TRACE_HEADER_SIZE + (size_t)num_jobs * TRACE_RECORD_SIZE)
+        return open_error(trace, "is not as long as its header says");
+    // A varint record is at least one byte per field
+    if (format == TRACE_VARINT && num_jobs > (trace->size - TRACE_HEADER_SIZE) / 3)
+        return open_error(trace, "is not as long as its header says");
+
+    trace->format = format;
+    trace->num_jobs = num_jobs;
+    trace->cursor = trace->map + TRACE_HEADER_SIZE;
+    trace->end = trace->map + trace->size;
+    return 0;
+}
+
+/**
+  Finds the jobs of a CSV trace and counts them. Blank lines at the end of
+  the file are ignored; anywhere else they are an error when reached.
+ */
+static void open_csv(trace_t *trace)
+{
+    const char *end = trace->map + trace->size;
+    const char *body = trace->size ? memchr(trace->map, '\n', trace->size) : NULL;
+
+    // Skip the header line and any blank lines at the end
+    body = body ? body + 1 : end;
+    while (end > body && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+
+    trace->format = TRACE_CSV;
+    trace->cursor = body;
+    trace->end = end;
+    trace->line = 2;
+
+    if (end > body)
+    {
+        const char *p = body;
+        trace->num_jobs = 1;
+        while ((p = memchr(p, '\n', end - p)) != NULL)
+        {
+            trace->num_jobs++;
+            p++;
+        }
+    }
+}
+
+/**
+  Maps a trace file, works out its format and counts its jobs.
+
+  @param trace a pointer to an instance of the trace_t data structure
+  @param file_name the trace
+  @return 0 on success, -1 if the file could not be opened or mapped, or
+          is not a trace this program can read
+ */
+int trace_open(trace_t *trace, const char *file_name)
+{
+    struct stat st;
+    int fd = open(file_name, O_RDONLY);
+
+    memset(trace, 0, sizeof(*trace));
+    trace->name = file_name;
+
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        snprintf(trace->error, sizeof(trace->error), "Unable to open file \"%s\".", file_name);
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+
+    trace->size = st.st_size;
+    if (trace->size > 0)
+    {
+        trace->map = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (trace->map == MAP_FAILED)
+        {
+            trace->map = NULL;
+            snprintf(trace->error, sizeof(trace->error), "Unable to map file \"%s\".", file_name);
+            close(fd);
+            return -1;
+        }
+        madvise(trace->map, trace->size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    if (trace->size >= TRACE_HEADER_SIZE && memcmp(trace->map, trace_magic, sizeof(trace_magic)) == 0)
+        return open_binary(trace);
+
+    open_csv(trace);
+    return 0;
+}
+
+/**
+  Reads an integer at *p, with optional spaces around it and an optional
+  sign, and moves *p past it.
+
+  @return 0, or -1 if there is no integer there or it does not fit an int
+ */
+static int scan_int(const char **p, const char *end, int *value)
+{
+    const char *s = *p;
+    long long v = 0;
+    int negative = 0;
+
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    if (s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+    if (s == end || *s < '0' || *s > '9')
+        return -1;
+    while (s < end && *s >= '0' && *s <= '9')
+    {
+        v = v * 10 + (*s++ - '0');
+        if (v > (long long)INT_MAX + 1)
+            return -1;
+    }
+    if (negative)
+        v = -v;
+    if (v > INT_MAX)
+        return -1;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+
+    *value = (int)v;
+    *p = s;
+    return 0;
+}
+
+static int next_csv(trace_t *trace, simulator_job_t *job, const char **next)
+{
+    const char *p = trace->cursor, *end = trace->end;
+
+    if (scan_int(&p, end, &job->arrival_time) != 0 || p == end || *p++ != ','
+        || scan_int(&p, end, &job->run_time) != 0 || p == end || *p++ != ','
+        || scan_int(&p, end, &job->priority) != 0)
+        return -1;
+    if (p < end && *p == '\r')
+        p++;
+    if (p < end && *p++ != '\n')
+        return -1;
+
+    *next = p;
+    return 0;
+}
+
+static int next_record(trace_t *trace, simulator_job_t *job, const char **next)
+{
+    const unsigned char *record = (const unsigned char *)trace->cursor;
+
+    job->arrival_time = (int32_t)get_le32(record);
+    job->run_time = (int32_t)get_le32(record + 4);
+    job->priority = (int32_t)get_le32(record + 8);
+
+    *next = trace->cursor + TRACE_RECORD_SIZE;
+    return 0;
+}
+
+static int get_varint(const char **p, const char *end, uint32_t *value)
+{
+    const unsigned char *s = (const unsigned char *)*p;
+    uint64_t v = 0;
+    int shift;
+
+    for (shift = 0; shift < 35; shift += 7)
+    {
+        if ((const char *)s == end)
+            return -1;
+        v |= (uint64_t)(*s & 0x7f) << shift;
+        if (!(*s++ & 0x80))
+        {
+            if (v > UINT32_MAX)
+                return -1;
+            *value = v;
+            *p = (const char *)s;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int next_varint(trace_t *trace, simulator_job_t *job, const char **next)
+{
+    const char *p = trace->cursor;
+    uint32_t delta, run_time, priority;
+    long long arrival_time;
+
+    if (get_varint(&p, trace->end, &delta) != 0 || get_varint(&p, trace->end, &run_time) != 0
+        || get_varint(&p, trace->end, &priority) != 0)
+        return -1;
+
+    arrival_time = (long long)trace->last_arrival + unzigzag(delta);
+    if (arrival_time < INT_MIN || arrival_time > INT_MAX || run_time > INT_MAX)
+        return -1;
+
+    job->arrival_time = arrival_time;
+    job->run_time = run_time;
+    job->priority = unzigzag(priority);
+
+    *next = p;
+    return 0;
+}
+
+static int fail(trace_t *trace, const char *what)
+{
+    if (trace->format == TRACE_CSV)
+        snprintf(trace->error, sizeof(trace->error), "Illegal file format in \"%s\" at line %d: %s.",
+                 trace->name, trace->line, what);
+    else
+        snprintf(trace->error, sizeof(trace->error), "Illegal file format in \"%s\" at job %d: %s.",
+                 trace->name, trace->next_job, what);
+    return -1;
+}
+
+/**
+  Reads the next job. If the trace is being streamed through trace_source,
+  jobs also have to come in order of arrival.
+
+  @param trace an open trace
+  @param job where the job is written
+  @return 1 if a job was read, 0 at the end of the trace, -1 on a
+          malformed job
+ */
+int trace_next(trace_t *trace, simulator_job_t *job)
+{
+    const char *next;
+    int status;
+
+    if (trace->next_job == trace->num_jobs)
+        return 0;
+
+    if (trace->format == TRACE_BINARY)
+        status = next_record(trace, job, &next);
+    else if (trace->format == TRACE_VARINT)
+        status = next_varint(trace, job, &next);
+    else
+        status = next_csv(trace, job, &next);
+
+    if (status != 0)
+        return fail(trace, trace->format == TRACE_CSV ? "expected three integer columns" : "the job is cut short");
+    if (job->arrival_time < 0)
+        return fail(trace, "the arrival time is negative");
+    if (job->run_time <= 0)
+        return fail(trace, "the run time is not positive");
+    if (trace->in_order && job->arrival_time < trace->last_arrival)
+        return fail(trace, "jobs have to be in order of arrival to be streamed");
+
+    job->job_id = trace->next_job++;
+    trace->last_arrival = job->arrival_time;
+    trace->cursor = next;
+    trace->line++;
+    return 1;
+}
+
+/**
+  Reads every job of an open trace into trace->jobs.
+
+  @return 0 on success, -1 on a malformed job or if the jobs do not fit in
+          memory
+ */
+int trace_load(trace_t *trace)
+{
+    int i;
+
+    trace->jobs = malloc(trace->num_jobs * sizeof(simulator_job_t));
+    if (trace->jobs == NULL)
+        return open_error(trace, "cannot be loaded: out of memory");
+    for (i = 0; i < trace->num_jobs; i++)
+        if (trace_next(trace, &trace->jobs[i]) != 1)
+            return -1;
+    return 0;
+}
+
+static int next_from_trace(void *context, simulator_job_t *job)
+{
+    return trace_next(context, job);
+}
+
+/**
+  Sets up a source that streams an open trace into simulator_run_source
+  without loading it. The trace has to be in order of arrival; the
+  simulation stops at the first job that is not.
+
+  @param trace an open trace nothing has been read from yet
+  @param source the source to set up
+ */
+void trace_source(trace_t *trace, simulator_source_t *source)
+{
+    trace->in_order = 1;
+    source->num_jobs = trace->num_jobs;
+    source->next = next_from_trace;
+    source->context = trace;
+}
+
+/**
+  Unmaps a trace and frees its jobs.
+ */
+void trace_close(trace_t *trace)
+{
+    if (trace->map != NULL)
+        munmap(trace->map, trace->size);
+    free(trace->jobs);
+    trace->map = NULL;
+    trace->jobs = NULL;
+}
+
+/**
+  Starts writing a trace: the CSV header line, or the header of a binary
+  trace. Binary headers hold the number of jobs, so it has to be known up
+  front, and exactly that many jobs written.
+
+  @param writer a pointer to an instance of the trace_writer_t data structure
+  @param file where the trace is written, open for writing
+  @param format the format to write
+  @param num_jobs how many jobs will be written
+  @return 0 on success, -1 if the file could not be written
+ */
+int trace_writer_open(trace_writer_t *writer, FILE *file, trace_format_t format, int num_jobs)
+{
+    unsigned char header[TRACE_HEADER_SIZE];
+
+    writer->file = file;
+    writer->format = format;
+    writer->last_arrival = 0;
+
+    if (format == TRACE_CSV)
+        return fputs("\"Arrival time\",\"Run time\",\"Priority\"\n", file) == EOF ? -1 : 0;
+
+    memcpy(header, trace_magic, sizeof(trace_magic));
+    put_le32(header + 8, TRACE_VERSION);
+    put_le32(header + 12, format);
+    put_le32(header + 16, num_jobs);
+    put_le32(header + 20, 0);
+    return fwrite(header, sizeof(header), 1, file) == 1 ? 0 : -1;
+}
+
+static int put_varint(unsigned char *p, uint32_t value)
+{
+    int n = 0;
+
+    while (value >= 0x80)
+    {
+        p[n++] = value | 0x80;
+        value >>= 7;
+    }
+    p[n++] = value;
+    return n;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return (uint32_t)value << 1 ^ (uint32_t)(value >> 31);
+}
+
+/**
+  Writes the next job of a trace. Its job_id is not written; jobs are
+  numbered by their place in the trace.
+
+  @return 0 on success, -1 if the file could not be written
+ */
+int trace_write(trace_writer_t *writer, const simulator_job_t *job)
+{
+    unsigned char record[3 * 5];
+    int n;
+
+    if (writer->format == TRACE_CSV)
+        return fprintf(writer->file, "%d,%d,%d\n", job->arrival_time, job->run_time, job->priority) < 0 ? -1 : 0;
+
+    if (writer->format == TRACE_BINARY)
+    {
+        put_le32(record, job->arrival_time);
+        put_le32(record + 4, job->run_time);
+        put_le32(record + 8, job->priority);
+        n = TRACE_RECORD_SIZE;
+    }
+    else
+    {
+        n = put_varint(record, zigzag((int32_t)((uint32_t)job->arrival_time - (uint32_t)writer->last_arrival)));
+        n += put_varint(record + n, job->run_time);
+        n += put_varint(record + n, zigzag(job->priority));
+        writer->last_arrival = job->arrival_time;
+    }
+    return fwrite(record, n, 1, writer->file) == 1 ? 0 : -1;
+}
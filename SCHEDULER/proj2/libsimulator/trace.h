@@ -0,0 +1,86 @@
+/** @file trace.h
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libsimulator.h"
+
+/**
+  How a trace file stores its jobs.
+
+  TRACE_CSV is the text format the examples are in. TRACE_BINARY and
+  TRACE_VARINT start with a binary header. TRACE_BINARY then has a
+  TRACE_RECORD_SIZE byte record per job: the arrival time, run time and
+  priority as little-endian 32-bit integers. TRACE_VARINT stores each job
+  as three LEB128 varints instead: the change in arrival time from the
+  previous job and the priority, both zigzag encoded, and the run time.
+*/
+typedef enum
+{
+  TRACE_CSV = 0,
+  TRACE_BINARY = 1,
+  TRACE_VARINT = 2
+} trace_format_t;
+
+/**
+  A binary trace starts with a TRACE_HEADER_SIZE byte header: the magic
+  "SCHEDTRC", then the format version, the trace_format_t of what follows,
+  the number of jobs and a reserved word, each a little-endian 32-bit
+  integer.
+*/
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 24
+#define TRACE_RECORD_SIZE 12
+
+/**
+  A trace file mapped into memory.
+
+  trace_open maps the file and works out its format and number of jobs;
+  the jobs are then either read all at once into jobs[] by trace_load or
+  handed out one at a time by trace_next, straight from the mapping. On
+  failure, error says what was wrong and where.
+*/
+typedef struct trace_t
+{
+  const char *name;
+  trace_format_t format;
+  simulator_job_t *jobs;
+  int num_jobs;
+
+  char *map;
+  size_t size;
+  const char *cursor;
+  const char *end;
+  int next_job;
+  int line;
+  int last_arrival;
+  int in_order;
+
+  char error[160];
+} trace_t;
+
+/**
+  Writes a trace one job at a time, in any of the formats.
+*/
+typedef struct trace_writer_t
+{
+  FILE *file;
+  trace_format_t format;
+  int last_arrival;
+} trace_writer_t;
+
+int  trace_open         (trace_t *trace, const char *file_name);
+int  trace_load         (trace_t *trace);
+int  trace_next         (trace_t *trace, simulator_job_t *job);
+void trace_source       (trace_t *trace, simulator_source_t *source);
+void trace_close        (trace_t *trace);
+
+int  trace_writer_open  (trace_writer_t *writer, FILE *file, trace_format_t format, int num_jobs);
+int  trace_write        (trace_writer_t *writer, const simulator_job_t *job);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,201 @@
+/** @file mtqueuebench.c
+
+  Measures how offer and poll throughput scales with threads, for
+  mtpriqueue against a single priqueue_t behind one global lock.
+
+  The queue starts with some elements in it, then every thread repeatedly
+  polls an element and offers it back with a new key. Results are written
+  as CSV: thread count, millions of operations per second for each queue
+  and the sharded queue's speedup.
+
+  Usage: mtqueuebench [-t max threads] [-n operations per run] [-s shards]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libpriqueue/libpriqueue.h"
+#include "libpriqueue/mtpriqueue.h"
+
+#define PREFILL 10000
+#define RUNS 3
+
+typedef struct item
+{
+    int key;
+} item;
+
+/**
+  One of the two queues under test, shared by every thread of a run.
+ */
+typedef struct bench_t
+{
+    int sharded;
+    mtpriqueue_t mt;
+    priqueue_t single;
+    pthread_mutex_t lock;
+    long ops_per_thread;
+} bench_t;
+
+typedef struct worker_t
+{
+    bench_t *b;
+    unsigned int seed;
+    pthread_t thread;
+} worker_t;
+
+int compare(const void * a, const void * b)
+{
+    return ( ((const item *)a)->key - ((const item *)b)->key );
+}
+
+static void bench_offer(bench_t *b, item *it)
+{
+    if (b->sharded)
+    {
+        mtpriqueue_offer(&b->mt, it);
+        return;
+    }
+    pthread_mutex_lock(&b->lock);
+    priqueue_offer(&b->single, it);
+    pthread_mutex_unlock(&b->lock);
+}
+
+static item *bench_poll(bench_t *b)
+{
+    if (b->sharded)
+        return mtpriqueue_poll(&b->mt);
+
+    pthread_mutex_lock(&b->lock);
+    item *it = priqueue_poll(&b->single);
+    pthread_mutex_unlock(&b->lock);
+    return it;
+}
+
+void *worker(void *arg)
+{
+    worker_t *w = arg;
+    bench_t *b = w->b;
+    long i;
+
+    for (i = 0; i < b->ops_per_thread; i += 2)
+    {
+        item *it = bench_poll(b);
+        if (it == NULL)
+            continue;
+        it->key += rand_r(&w->seed) % 1000;
+        bench_offer(b, it);
+    }
+
+    return NULL;
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+  Runs threads workers against one kind of queue.
+
+  @return millions of operations per second
+ */
+static double run(int sharded, int shards, int threads, long ops, item *items)
+{
+    bench_t b;
+    worker_t *workers = malloc(threads * sizeof(worker_t));
+    int i;
+
+    b.sharded = sharded;
+    b.ops_per_thread = ops / threads;
+    if (sharded)
+        mtpriqueue_init(&b.mt, compare, shards);
+    else
+    {
+        priqueue_init(&b.single, compare);
+        pthread_mutex_init(&b.lock, NULL);
+    }
+
+    for (i = 0; i < PREFILL; i++)
+    {
+        items[i].key = i % 1000;
+        bench_offer(&b, &items[i]);
+    }
+
+    double start = now_ns();
+    for (i = 0; i < threads; i++)
+    {
+        workers[i].b = &b;
+        workers[i].seed = 678 + i;
+        pthread_create(&workers[i].thread, NULL, worker, &workers[i]);
+    }
+    for (i = 0; i < threads; i++)
+        pthread_join(workers[i].thread, NULL);
+    double elapsed = now_ns() - start;
+
+    if (sharded)
+        mtpriqueue_destroy(&b.mt);
+    else
+    {
+        priqueue_destroy(&b.single);
+        pthread_mutex_destroy(&b.lock);
+    }
+    free(workers);
+
+    return (double)b.ops_per_thread * threads / elapsed * 1e3;
+}
+
+/**
+  Runs a configuration RUNS times and keeps the fastest.
+ */
+static double best_of(int sharded, int shards, int threads, long ops, item *items)
+{
+    double best = 0;
+    int r;
+
+    for (r = 0; r < RUNS; r++)
+    {
+        double mops = run(sharded, shards, threads, ops, items);
+        if (mops > best)
+            best = mops;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 64, shards = 0;
+    long ops = 2000000;
+    int c, t;
+
+    while ((c = getopt(argc, argv, "t:n:s:")) != -1)
+    {
+        switch (c)
+        {
+            case 't': max_threads = atoi(optarg); break;
+            case 'n': ops = atol(optarg); break;
+            case 's': shards = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-t max threads] [-n operations per run] [-s shards]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    item *items = malloc(PREFILL * sizeof(item));
+
+    printf("threads,locked_mops,sharded_mops,speedup\n");
+    for (t = 1; t <= max_threads; t *= 2)
+    {
+        double locked = best_of(0, shards, t, ops, items);
+        double sharded = best_of(1, shards, t, ops, items);
+        printf("%d,%.2f,%.2f,%.2f\n", t, locked, sharded, sharded / locked);
+    }
+
+    free(items);
+    return 0;
+}
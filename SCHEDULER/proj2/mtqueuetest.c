@@ -0,0 +1,197 @@
+/** @file mtqueuetest.c
+
+  Stress test for mtpriqueue. Producer and consumer threads hammer one
+  queue and every element has to come out exactly once. Exits non-zero on
+  the first failure.
+
+  Usage: mtqueuetest [-t max threads] [-n elements per producer]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "libpriqueue/mtpriqueue.h"
+
+typedef struct item
+{
+    int key;
+    int taken;
+} item;
+
+typedef struct stress_t
+{
+    mtpriqueue_t q;
+    item *items;
+    int per_producer;
+    int total;
+    int consumed;
+} stress_t;
+
+typedef struct worker_t
+{
+    stress_t *s;
+    int id;
+    pthread_t thread;
+} worker_t;
+
+int compare(const void * a, const void * b)
+{
+    return ( ((const item *)a)->key - ((const item *)b)->key );
+}
+
+void *producer(void *arg)
+{
+    worker_t *w = arg;
+    stress_t *s = w->s;
+    int i;
+
+    for (i = 0; i < s->per_producer; i++)
+        mtpriqueue_offer(&s->q, &s->items[w->id * s->per_producer + i]);
+
+    return NULL;
+}
+
+void *consumer(void *arg)
+{
+    worker_t *w = arg;
+    stress_t *s = w->s;
+
+    while (__atomic_load_n(&s->consumed, __ATOMIC_RELAXED) < s->total)
+    {
+        item *it = mtpriqueue_poll(&s->q);
+        if (it == NULL)
+        {
+            sched_yield();
+            continue;
+        }
+
+        __atomic_fetch_add(&it->taken, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&s->consumed, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/**
+  Runs producers and consumers against one queue and checks every element
+  was taken once.
+ */
+int stress(int producers, int consumers, int shards, int per_producer)
+{
+    stress_t s;
+    int i;
+
+    s.per_producer = per_producer;
+    s.total = producers * per_producer;
+    s.consumed = 0;
+    s.items = malloc(s.total * sizeof(item) + 1);
+    for (i = 0; i < s.total; i++)
+    {
+        s.items[i].key = rand() % 1000;
+        s.items[i].taken = 0;
+    }
+
+    if (mtpriqueue_init(&s.q, compare, shards) != 0)
+    {
+        printf("mtpriqueue_init failed\n");
+        return 1;
+    }
+
+    worker_t *workers = malloc((producers + consumers) * sizeof(worker_t));
+    for (i = 0; i < producers + consumers; i++)
+    {
+        workers[i].s = &s;
+        workers[i].id = i < producers ? i : i - producers;
+        pthread_create(&workers[i].thread, NULL, i < producers ? producer : consumer, &workers[i]);
+    }
+    for (i = 0; i < producers + consumers; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    int failures = 0;
+    for (i = 0; i < s.total; i++)
+        if (s.items[i].taken != 1)
+            failures++;
+
+    if (failures > 0 || mtpriqueue_size(&s.q) != 0 || mtpriqueue_poll(&s.q) != NULL)
+    {
+        printf("%d producers, %d consumers, %d shards: %d of %d elements not taken exactly once (expected 0), %d left\n",
+               producers, consumers, shards, failures, s.total, mtpriqueue_size(&s.q));
+        return 1;
+    }
+
+    mtpriqueue_destroy(&s.q);
+    free(workers);
+    free(s.items);
+    return 0;
+}
+
+/**
+  With one shard the queue must hand elements out exactly like priqueue_t.
+ */
+int single_shard_order()
+{
+    mtpriqueue_t q;
+    priqueue_t ref;
+    item items[100];
+    int i;
+
+    mtpriqueue_init(&q, compare, 1);
+    priqueue_init(&ref, compare);
+    for (i = 0; i < 100; i++)
+    {
+        items[i].key = (i * 37) % 10;
+        mtpriqueue_offer(&q, &items[i]);
+        priqueue_offer(&ref, &items[i]);
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        if (mtpriqueue_poll(&q) != priqueue_poll(&ref))
+        {
+            printf("Single shard order differs from priqueue_t at element %d\n", i);
+            return 1;
+        }
+    }
+
+    priqueue_destroy(&ref);
+    mtpriqueue_destroy(&q);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads = 64, per_producer = 20000;
+    int c, t;
+
+    while ((c = getopt(argc, argv, "t:n:")) != -1)
+    {
+        switch (c)
+        {
+            case 't': max_threads = atoi(optarg); break;
+            case 'n': per_producer = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-t max threads] [-n elements per producer]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (single_shard_order())
+        return 1;
+    printf("Single shard order: ok\n");
+
+    for (t = 2; t <= max_threads; t *= 2)
+    {
+        // Even splits, then lopsided ones in both directions
+        if (stress(t / 2, t / 2, 0, per_producer / t + 1) ||
+            stress(1, t - 1, 0, per_producer) ||
+            stress(t - 1, 1, 0, per_producer / t + 1) ||
+            stress(t / 2, t / 2, 1, per_producer / t + 1))
+            return 1;
+        printf("%d threads: ok\n", t);
+    }
+
+    return 0;
+}
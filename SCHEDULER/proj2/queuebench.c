@@ -0,0 +1,346 @@
+/** @file queuebench.c
+
+  Times the heap in libpriqueue against the original linked list queue and
+  against a queue generated with PRIQUEUE_DEFINE.
+
+  Each workload is run on every queue with the same keys, and the order
+  elements come out in is checked to be identical. Results are written as
+  CSV: workload, queue length, ns per operation for each queue, the
+  heap's speedup over the list and the generated queue's speedup over the
+  heap. The list is O(n) per operation, so it is only run up to the
+  length given with -l. The generated queue has no handles, so it sits
+  out the cancel workload.
+
+  Usage: queuebench [-n max length] [-l max list length]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libpriqueue/libpriqueue.h"
+#include "libpriqueue/listqueue.h"
+#include "libpriqueue/priqueue_define.h"
+
+typedef struct bench_job_t
+{
+    int time;
+    int running_time;
+    int handle;
+} bench_job_t;
+
+/* The same tie-break as sjf_compare in libscheduler */
+int job_compare(const void * a, const void * b)
+{
+    const bench_job_t * job1 = a;
+    const bench_job_t * job2 = b;
+
+    if((job1->running_time - job2->running_time) == 0)
+    {
+        if(job1->time > job2->time)
+        {
+            return (1);
+        }
+    }
+    return ( job1->running_time - job2->running_time );
+}
+
+int fifo_compare(const void * a, const void * b)
+{
+    return (1);
+}
+
+#define SJF_KEY(job) ((long long)(job)->running_time * 4294967296LL + (unsigned int)(job)->time)
+
+PRIQUEUE_DEFINE(bench_sjf_queue, bench_job_t *, SJF_KEY(x))
+PRIQUEUE_DEFINE(bench_fifo_queue, bench_job_t *, 0)
+
+#define RUNS 3
+
+typedef enum {FILL = 0, HOLD, BULK, CANCEL} workload_t;
+
+static const char *workload_names[] = {"fill", "hold", "bulk", "cancel"};
+
+typedef enum {LIST = 0, HEAP, INLINE} kind_t;
+
+/**
+  A queue under test: any kind behind the same operations.
+ */
+typedef struct bench_queue_t
+{
+    kind_t kind;
+    int fifo;
+    listqueue_t list;
+    priqueue_t heap;
+    bench_sjf_queue_t sjf;
+    bench_fifo_queue_t fifo_queue;
+} bench_queue_t;
+
+static void bq_init(bench_queue_t *bq, kind_t kind, int fifo)
+{
+    bq->kind = kind;
+    bq->fifo = fifo;
+    if (kind == LIST)
+        listqueue_init(&bq->list, fifo ? fifo_compare : job_compare);
+    else if (kind == HEAP)
+        priqueue_init(&bq->heap, fifo ? fifo_compare : job_compare);
+    else if (fifo)
+        bench_fifo_queue_init(&bq->fifo_queue);
+    else
+        bench_sjf_queue_init(&bq->sjf);
+}
+
+static void bq_offer(bench_queue_t *bq, bench_job_t *job)
+{
+    if (bq->kind == LIST)
+        listqueue_offer(&bq->list, job);
+    else if (bq->kind == HEAP)
+        job->handle = priqueue_offer(&bq->heap, job);
+    else if (bq->fifo)
+        bench_fifo_queue_offer(&bq->fifo_queue, job);
+    else
+        bench_sjf_queue_offer(&bq->sjf, job);
+}
+
+/* Only the heap can take a batch in one call; the others offer singly */
+static void bq_offer_all(bench_queue_t *bq, bench_job_t *jobs, void **ptrs, int n)
+{
+    int i;
+
+    if (bq->kind == HEAP)
+    {
+        priqueue_offer_bulk(&bq->heap, ptrs, n);
+        return;
+    }
+    for (i = 0; i < n; i++)
+        bq_offer(bq, &jobs[i]);
+}
+
+/* The list has to search for the job; the heap goes straight to it */
+static void bq_cancel(bench_queue_t *bq, bench_job_t *job)
+{
+    if (bq->kind == LIST)
+        listqueue_remove(&bq->list, job);
+    else
+        priqueue_remove_handle(&bq->heap, job->handle);
+}
+
+static bench_job_t *bq_poll(bench_queue_t *bq)
+{
+    bench_job_t *job = NULL;
+
+    if (bq->kind == LIST)
+        job = listqueue_poll(&bq->list);
+    else if (bq->kind == HEAP)
+        job = priqueue_poll(&bq->heap);
+    else if (bq->fifo)
+        bench_fifo_queue_poll(&bq->fifo_queue, &job);
+    else
+        bench_sjf_queue_poll(&bq->sjf, &job);
+    return job;
+}
+
+static void bq_destroy(bench_queue_t *bq)
+{
+    if (bq->kind == LIST)
+        listqueue_destroy(&bq->list);
+    else if (bq->kind == HEAP)
+        priqueue_destroy(&bq->heap);
+    else if (bq->fifo)
+        bench_fifo_queue_destroy(&bq->fifo_queue);
+    else
+        bench_sjf_queue_destroy(&bq->sjf);
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+  Runs one workload and returns the time per operation in ns. The jobs
+  polled are summed by position into *order_hash so runs can be compared.
+
+  fill offers n jobs and then polls them all. hold keeps n jobs queued and
+  repeatedly polls one and offers it again with a new key, the way a
+  scheduler cycles jobs through its queue. bulk times offering n jobs as
+  one batch. cancel offers n jobs and then removes every other one from
+  the middle of the queue.
+ */
+static double run(workload_t workload, kind_t kind, int fifo,
+                  bench_job_t *jobs, int n, unsigned long *order_hash)
+{
+    bench_queue_t bq;
+    unsigned long hash = 0;
+    unsigned int seed = 678;
+    long ops = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        jobs[i].time = i;
+        jobs[i].running_time = rand_r(&seed) % 1000;
+    }
+
+    bq_init(&bq, kind, fifo);
+    double start = now_ns();
+
+    if (workload == FILL)
+    {
+        for (i = 0; i < n; i++)
+            bq_offer(&bq, &jobs[i]);
+        for (i = 0; i < n; i++)
+            hash = hash * 31 + (bq_poll(&bq) - jobs);
+        ops = 2L * n;
+    }
+    else if (workload == BULK)
+    {
+        void **ptrs = malloc(n * sizeof(void *));
+        for (i = 0; i < n; i++)
+            ptrs[i] = &jobs[i];
+
+        start = now_ns();
+        bq_offer_all(&bq, jobs, ptrs, n);
+        double built = now_ns();
+
+        for (i = 0; i < n; i++)
+            hash = hash * 31 + (bq_poll(&bq) - jobs);
+        start += now_ns() - built;
+        ops = n;
+        free(ptrs);
+    }
+    else if (workload == CANCEL)
+    {
+        for (i = 0; i < n; i++)
+            bq_offer(&bq, &jobs[i]);
+
+        start = now_ns();
+        for (i = 0; i < n; i += 2)
+            bq_cancel(&bq, &jobs[i]);
+        double cancelled = now_ns();
+
+        for (i = 1; i < n; i += 2)
+            hash = hash * 31 + (bq_poll(&bq) - jobs);
+        start += now_ns() - cancelled;
+        ops = (n + 1) / 2;
+    }
+    else
+    {
+        for (i = 0; i < n; i++)
+            bq_offer(&bq, &jobs[i]);
+
+        start = now_ns();
+        for (i = 0; i < n; i++)
+        {
+            bench_job_t *job = bq_poll(&bq);
+            hash = hash * 31 + (job - jobs);
+            job->time = n + i;
+            job->running_time = rand_r(&seed) % 1000;
+            bq_offer(&bq, job);
+        }
+        ops = 2L * n;
+    }
+
+    double elapsed = now_ns() - start;
+    bq_destroy(&bq);
+
+    *order_hash = hash;
+    return elapsed / ops;
+}
+
+/**
+  Runs a workload RUNS times and keeps the fastest, which is the least
+  disturbed by the rest of the machine.
+ */
+static double best_of(workload_t workload, kind_t kind, int fifo,
+                      bench_job_t *jobs, int n, unsigned long *order_hash)
+{
+    double best = 0;
+    int r;
+
+    for (r = 0; r < RUNS; r++)
+    {
+        double ns = run(workload, kind, fifo, jobs, n, order_hash);
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int max_n = 100000, max_list = 20000;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:l:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n': max_n = atoi(optarg); break;
+            case 'l': max_list = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n max length] [-l max list length]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    bench_job_t *jobs = malloc(max_n * sizeof(bench_job_t));
+    int status = 0;
+    int w, n, fifo;
+
+    printf("workload,n,list_ns_per_op,heap_ns_per_op,inline_ns_per_op,speedup,inline_speedup\n");
+    for (fifo = 0; fifo < 2; fifo++)
+    {
+        for (w = FILL; w <= CANCEL; w++)
+        {
+            for (n = 1000; n <= max_n; n *= 10)
+            {
+                const char *name = workload_names[w];
+                unsigned long heap_hash, list_hash, inline_hash;
+                double heap_ns = best_of(w, HEAP, fifo, jobs, n, &heap_hash);
+                double list_ns = 0, inline_ns = 0;
+
+                if (n <= max_list)
+                {
+                    list_ns = best_of(w, LIST, fifo, jobs, n, &list_hash);
+                    if (list_hash != heap_hash)
+                    {
+                        fprintf(stderr, "%s%s with %d jobs: the heap and the list disagree on order\n",
+                                fifo ? "fifo_" : "sjf_", name, n);
+                        status = 2;
+                    }
+                }
+                if (w != CANCEL)
+                {
+                    inline_ns = best_of(w, INLINE, fifo, jobs, n, &inline_hash);
+                    if (inline_hash != heap_hash)
+                    {
+                        fprintf(stderr, "%s%s with %d jobs: the heap and the generated queue disagree on order\n",
+                                fifo ? "fifo_" : "sjf_", name, n);
+                        status = 2;
+                    }
+                }
+
+                printf("%s%s,%d,", fifo ? "fifo_" : "sjf_", name, n);
+                if (list_ns > 0)
+                    printf("%.1f", list_ns);
+                printf(",%.1f,", heap_ns);
+                if (inline_ns > 0)
+                    printf("%.1f", inline_ns);
+                printf(",");
+                if (list_ns > 0)
+                    printf("%.1f", list_ns / heap_ns);
+                printf(",");
+                if (inline_ns > 0)
+                    printf("%.1f", heap_ns / inline_ns);
+                printf("\n");
+            }
+        }
+    }
+
+    free(jobs);
+    return status;
+}
@@ -64,6 +64,80 @@ int main()
 		printf("%d ", *((int *)priqueue_at(&q2, i)) );
 	printf("\n");
 
+	/* Change a queued element's key through its handle. */
+	int handle = priqueue_offer(&q2, &values[5]);
+	values[5] = 25;
+	priqueue_update_key(&q2, handle);
+	printf("After update_key (expected 30 25 20 10): ");
+	for (i = 0; i < priqueue_size(&q2); i++)
+		printf("%d ", *((int *)priqueue_at(&q2, i)) );
+	printf("\n");
+
+	values[5] = 40;
+	priqueue_decrease_key(&q2, handle);
+	printf("Top element after decrease_key: %d (expected 40).\n", *((int *)priqueue_peek(&q2)));
+
+	val = *((int *)priqueue_remove_handle(&q2, handle));
+	printf("Removed by handle: %d (expected 40).\n", val);
+	printf("Removed again: %s (expected NULL).\n", priqueue_remove_handle(&q2, handle) ? "not NULL" : "NULL");
+	printf("Elements in reverse order queue (expected 30 20 10): ");
+	for (i = 0; i < priqueue_size(&q2); i++)
+		printf("%d ", *((int *)priqueue_at(&q2, i)) );
+	printf("\n");
+
+	/* Walk the queue with an iterator, dropping 20 on the way. */
+	priqueue_iter_t it;
+	int *elem;
+	printf("Iterated order queue (expected 10 13 14 20 30): ");
+	priqueue_iter_init(&it, &q);
+	while ((elem = priqueue_iter_next(&it)) != NULL)
+	{
+		printf("%d ", *elem);
+		if (*elem == 20)
+			priqueue_iter_remove(&it);
+	}
+	printf("\n");
+	printf("Total elements: %d (expected 4).\n", priqueue_size(&q));
+
+	while (priqueue_poll(&q) != NULL)
+		;
+	printf("Total elements in an empty queue: %d (expected 0).\n", priqueue_size(&q));
+
+	/* Build a queue in one go and merge it into another. */
+	void *batch[] = { &values[40], &values[15], &values[25], &values[15] };
+	priqueue_offer_bulk(&q, batch, 4);
+	priqueue_offer(&q2, &values[50]);
+	priqueue_offer(&q2, &values[6]);
+	priqueue_merge(&q, &q2);
+	printf("Merged queue (expected 6 10 15 15 20 25 30 40 50): ");
+	while ((elem = priqueue_poll(&q)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+	printf("Total elements left in the merged-from queue: %d (expected 0).\n", priqueue_size(&q2));
+
+	/* Elements that tie leave in the order they were offered. */
+	int ties[] = { 7, 7, 7, 7 };
+	priqueue_t q3;
+	priqueue_init(&q3, compare1);
+	for (i = 0; i < 3; i++)
+		priqueue_offer(&q3, &ties[i]);
+	printf("Tied elements (expected 0 1 2): ");
+	while ((elem = priqueue_poll(&q3)) != NULL)
+		printf("%d ", (int)(elem - ties));
+	printf("\n");
+
+	/* The same goes for bulk offers, and merged elements follow dst's. */
+	void *front[] = { &ties[0], &ties[1] };
+	void *back[] = { &ties[2], &ties[3] };
+	priqueue_offer_bulk(&q3, front, 2);
+	priqueue_offer_bulk(&q2, back, 2);
+	priqueue_merge(&q3, &q2);
+	printf("Merged tied elements (expected 0 1 2 3): ");
+	while ((elem = priqueue_poll(&q3)) != NULL)
+		printf("%d ", (int)(elem - ties));
+	printf("\n");
+	priqueue_destroy(&q3);
+
 	priqueue_destroy(&q2);
 	priqueue_destroy(&q);
 
@@ -0,0 +1,88 @@
+/** @file replay.c
+
+  Feeds a binary event log recorded with simulator -b back to a fresh
+  scheduler, one call at a time, and checks the scheduler still makes
+  every decision the log has. This tells whether a change to libscheduler
+  changed any schedule without rerunning and comparing whole simulations.
+
+  Stops at the first decision that differs and exits with 3; otherwise
+  prints the averages, as the simulator does.
+
+  Usage: replay <event log>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libscheduler/libscheduler.h"
+#include "libscheduler/log.h"
+
+static const char *event_names[] = {"arrival of job", "finish of job", "quantum expiry on core"};
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <event log>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    log_header_t header;
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Unable to open file \"%s\".\n", argv[1]);
+        return 2;
+    }
+    if (log_read_header(file, &header) != 0)
+    {
+        fprintf(stderr, "\"%s\" is not an event log.\n", argv[1]);
+        return 2;
+    }
+
+    scheduler_t *s = scheduler_create(header.cores, header.scheme);
+    log_event_t event;
+    long events = 0;
+    int status = 0;
+
+    scheduler_set_quiet(s, true);
+    while (status == 0 && log_read_event(file, &event))
+    {
+        int decision = -1;
+
+        if (event.type == LOG_EVENT_ARRIVAL)
+            decision = scheduler_new_job_r(s, event.job, event.time, event.running_time, event.priority);
+        else if (event.type == LOG_EVENT_FINISHED)
+            decision = scheduler_job_finished_r(s, event.core, event.job, event.time);
+        else if (event.type == LOG_EVENT_EXPIRED)
+            decision = scheduler_quantum_expired_r(s, event.core, event.time);
+        else
+        {
+            fprintf(stderr, "Event %ld has an unknown type %d.\n", events, event.type);
+            status = 2;
+            break;
+        }
+
+        if (decision != event.decision)
+        {
+            printf("Event %ld, %s %d at time %d: the scheduler now decides %d, the log has %d.\n",
+                   events, event_names[event.type], event.type == LOG_EVENT_EXPIRED ? event.core : event.job,
+                   event.time, decision, event.decision);
+            status = 3;
+        }
+        events++;
+    }
+
+    if (status == 0)
+    {
+        printf("Replayed %ld event(s), all decisions match.\n", events);
+        printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time_r(s));
+        printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time_r(s));
+        printf("Average Response Time: %.2f\n", scheduler_average_response_time_r(s));
+    }
+
+    scheduler_destroy(s);
+    fclose(file);
+    return status;
+}
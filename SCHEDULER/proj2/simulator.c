@@ -5,6 +5,10 @@
 #include <assert.h>
 
 #include "libscheduler/libscheduler.h"
+#include "libscheduler/log.h"
+#include "libsimulator/libsimulator.h"
+#include "libsimulator/diagram.h"
+#include "libsimulator/trace.h"
 
 
 typedef struct _simulator_job_list_t
@@ -15,10 +19,15 @@ typedef struct _simulator_job_list_t
 
 void print_usage(char *program_name)
 {
-	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> [-q | -S] [-l <level>] [-b <event log>] [-d <diagram>] [-j <json>] <input file>\n", program_name);
 	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
+	fprintf(stderr, "-q prints only the final averages; -l shows messages up to error, warn, info or debug\n");
+	fprintf(stderr, "The input file is a CSV trace or a binary one made by traceconv\n");
+	fprintf(stderr, "-S is -q reading jobs from the file as they arrive; the file has to be in order of arrival\n");
+	fprintf(stderr, "-b records every scheduler decision to a binary event log for replay\n");
+	fprintf(stderr, "-d and -j save the timing diagram in binary or as Chrome trace JSON\n");
 }
 
 int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
@@ -38,7 +47,7 @@ int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int acti
 
 void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
 {
-	printf("Active jobs are: ");
+	LOG(LOG_ERROR, "Active jobs are: ");
 
 	int i, first = 1;
 	for (i = 0; i < active_jobs; i++)
@@ -47,43 +56,91 @@ void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
 		{
 			if (first)
 			{
-				printf("%d", jobs[i].job_id);
+				LOG(LOG_ERROR, "%d", jobs[i].job_id);
 				first = 0;
 			}
 			else
-				printf(", %d", jobs[i].job_id);
+				LOG(LOG_ERROR, ", %d", jobs[i].job_id);
 		}
 	}
 
 	if (!first)
-		printf("\n");
+		LOG(LOG_ERROR, "\n");
 }
 
 void print_available_cores(int cores)
 {
-	printf("Active cores are: ");
+	LOG(LOG_ERROR, "Active cores are: ");
 
 	int i;
 	for (i = 0; i < cores; i++)
 	{
 		if (i == cores - 1)
-			printf("%d\n", i);
+			LOG(LOG_ERROR, "%d\n", i);
 		else
-			printf("%d, ", i);
+			LOG(LOG_ERROR, "%d, ", i);
+	}
+}
+
+void print_diagram(const diagram_t *diagram, int cores, int end)
+{
+	int i;
+	for (i = 0; i < cores; i++)
+	{
+		printf("  Core %2d: ", i);
+		diagram_print_row(diagram, i, end, stdout);
+		printf("\n");
+	}
+}
+
+int save_diagram(const diagram_t *diagram, int end, char *binary_name, char *json_name)
+{
+	FILE *file;
+
+	if (binary_name != NULL)
+	{
+		file = fopen(binary_name, "wb");
+		if (file == NULL || diagram_write_binary(diagram, end, file) != 0 || fclose(file) != 0)
+		{
+			fprintf(stderr, "Unable to write diagram \"%s\".\n", binary_name);
+			return 2;
+		}
+	}
+
+	if (json_name != NULL)
+	{
+		file = fopen(json_name, "w");
+		if (file == NULL || diagram_write_chrome(diagram, file) != 0 || fclose(file) != 0)
+		{
+			fprintf(stderr, "Unable to write diagram \"%s\".\n", json_name);
+			return 2;
+		}
+	}
+
+	return 0;
+}
+
+void show_queue(scheduler_t *scheduler)
+{
+	if (LOG_ENABLED(LOG_INFO))
+	{
+		printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
 	}
 }
 
 
 int main(int argc, char **argv)
 {
-	int c;
+	int c, i;
 	int cores = 0, scheme = -1, quantum = 0;
-	char *file_name;
+	int quiet = 0, stream = 0, level = -1;
+	char *file_name, *event_log_name = NULL;
+	char *diagram_name = NULL, *json_name = NULL;
 
 	/*
 	 * Parse command line options.
 	 */
-	while ((c = getopt(argc, argv, "c:s:")) != -1)
+	while ((c = getopt(argc, argv, "c:s:qSl:b:d:j:")) != -1)
 	{
 		switch (c)
 		{
@@ -118,6 +175,37 @@ int main(int argc, char **argv)
 				}
 				break;
 
+			case 'q':
+				quiet = 1;
+				break;
+
+			case 'S':
+				quiet = stream = 1;
+				break;
+
+			case 'l':
+				level = log_parse_level(optarg);
+
+				if (level == -1)
+				{
+					fprintf(stderr, "Option -l <level> requires one of error, warn, info or debug.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'b':
+				event_log_name = optarg;
+				break;
+
+			case 'd':
+				diagram_name = optarg;
+				break;
+
+			case 'j':
+				json_name = optarg;
+				break;
+
 			case '?':
 				print_usage(argv[0]);
 				return 1;
@@ -153,94 +241,140 @@ int main(int argc, char **argv)
 
 
 	/*
-	 * Open the file, read the file, and populate the jobs data structure.
+	 * Map the file and read the jobs, unless -S streams them into the simulation.
 	 */
-	FILE *file = fopen(file_name, "r");
-	if (file == NULL)
+	trace_t trace;
+	if (trace_open(&trace, file_name) != 0)
 	{
-		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		fprintf(stderr, "%s\n", trace.error);
 		return 2;
 	}
 
+	int job_id = trace.num_jobs;
+	simulator_job_list_t *jobs = NULL;
 
-	int job_id = 0;
-	int jobs_ct = 10;
-	simulator_job_list_t* jobs = malloc(jobs_ct * sizeof(simulator_job_list_t));
-
-	char line[1024 + 1];
-	fgets(line, 1024, file);  // Ignore the first (header) line
-	while (fgets(line, 1024, file) != NULL)
+	if (!stream)
 	{
-		char *arrival_time = strtok(line, ",");
-		char *run_time = strtok(NULL, ",");
-		char *priority = strtok(NULL, ",");
+		if (trace_load(&trace) != 0)
+		{
+			fprintf(stderr, "%s\n", trace.error);
+			trace_close(&trace);
+			return 2;
+		}
 
-		if (arrival_time != NULL && run_time != NULL && priority != NULL)
+		jobs = malloc(job_id * sizeof(simulator_job_list_t));
+		if (jobs == NULL)
 		{
-			if (job_id == jobs_ct)
-			{
-				jobs_ct *= 2;
-				jobs = realloc(jobs, jobs_ct * sizeof(simulator_job_list_t));
+			fprintf(stderr, "Not enough memory to simulate \"%s\".\n", file_name);
+			trace_close(&trace);
+			return 4;
+		}
+		for (i = 0; i < job_id; i++)
+		{
+			jobs[i].job_id = trace.jobs[i].job_id;
+			jobs[i].arrival_time = trace.jobs[i].arrival_time;
+			jobs[i].run_time = trace.jobs[i].run_time;
+			jobs[i].priority = trace.jobs[i].priority;
+			jobs[i].core_id = -1;
+			jobs[i].arrived = 0;
+		}
+	}
 
-				if (!jobs)
-				{
-					fprintf(stderr, "Out of memory.\n");
-					return 2;
-				}
-			}
 
-			jobs[job_id].job_id = job_id;
-			jobs[job_id].arrival_time = atoi(arrival_time);
-			jobs[job_id].run_time = atoi(run_time);
-			jobs[job_id].priority = atoi(priority);
-			jobs[job_id].core_id = -1;
-			jobs[job_id].arrived = 0;
+	/*
+	 * -q leaves nothing to print but the averages, down to warnings, unless -l says otherwise.
+	 */
+	if (quiet && level == -1)
+		level = LOG_WARN;
+	if (level != -1)
+		log_set_level(level);
 
-			job_id++;
-		}
-		else
+	scheduler_t *scheduler = scheduler_create(cores, scheme);
+	diagram_t diagram;
+
+	diagram_init(&diagram, cores);
+
+	FILE *event_log = NULL;
+	if (event_log_name != NULL)
+	{
+		event_log = fopen(event_log_name, "wb");
+		if (event_log == NULL || scheduler_set_event_log(scheduler, event_log) != 0)
 		{
-			fprintf(stderr, "Illegal file format.\n");
+			fprintf(stderr, "Unable to write event log \"%s\".\n", event_log_name);
 			return 2;
 		}
 	}
 
-	fclose(file);
+
+	/*
+	 * Quiet runs skip from event to event instead of stepping through every time unit.
+	 */
+	if (quiet)
+	{
+		simulator_result_t result;
+
+		if (stream)
+		{
+			simulator_source_t source;
+
+			trace_source(&trace, &source);
+			simulator_run_source(scheduler, &source, cores, scheme, quantum, &diagram, &result);
+		}
+		else
+			simulator_run(scheduler, trace.jobs, job_id, cores, scheme, quantum, &diagram, &result);
+
+		if (result.status == 0)
+		{
+			if (save_diagram(&diagram, result.makespan, diagram_name, json_name) != 0)
+				return 2;
+
+			printf("Average Waiting Time: %.2f\n", result.waiting);
+			printf("Average Turnaround Time: %.2f\n", result.turnaround);
+			printf("Average Response Time: %.2f\n", result.response);
+		}
+		else if (result.status == 2)
+			fprintf(stderr, "%s\n", trace.error);
+		else if (result.status == 4)
+			fprintf(stderr, "Not enough memory to simulate \"%s\".\n", file_name);
+		else
+			LOG(LOG_ERROR, "The scheduler made an invalid choice at time %d.\n", result.makespan);
+
+		scheduler_destroy(scheduler);
+		diagram_destroy(&diagram);
+		if (event_log != NULL)
+			fclose(event_log);
+		trace_close(&trace);
+		free(jobs);
+		return result.status;
+	}
 
 
 	/*
 	 * Run the simulation.
 	 */
 
-	printf("Loaded %d core(s) and %d job(s) using ", cores, job_id);
-	if (scheme == FCFS) { printf("First Come First Served (FCFS)"); }
-	else if (scheme == SJF) { printf("Non-preemptive Shortest Job First (SJF)"); }
-	else if (scheme == PSJF) { printf("Preemptive Shortest Job First (PSJF)"); }
-	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
-	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
-	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
-	printf(" scheduling...\n\n");
-
-	scheduler_start_up(cores, scheme);
+	LOG(LOG_INFO, "Loaded %d core(s) and %d job(s) using ", cores, job_id);
+	if (scheme == FCFS) { LOG(LOG_INFO, "First Come First Served (FCFS)"); }
+	else if (scheme == SJF) { LOG(LOG_INFO, "Non-preemptive Shortest Job First (SJF)"); }
+	else if (scheme == PSJF) { LOG(LOG_INFO, "Preemptive Shortest Job First (PSJF)"); }
+	else if (scheme == PRI) { LOG(LOG_INFO, "Non-preemptive Priority (PRI)"); }
+	else if (scheme == PPRI) { LOG(LOG_INFO, "Preemptive Priority (PPRI)"); }
+	else if (scheme == RR) { LOG(LOG_INFO, "Round Robin (RR) with a quantum of %d", quantum); }
+	LOG(LOG_INFO, " scheduling...\n\n");
 
 
-	int time = 0, i, j;
+	int time = 0, j;
 	int active_jobs = job_id, jobs_alive = 0;
 
 	int *quantum_clock = malloc(cores * sizeof(int));
-	char **core_timing_diagram = malloc(cores * sizeof(char *));
-	int core_timing_diagram_size = 1024;
+	int *core_job = malloc(cores * sizeof(int));
 
 	for (i = 0; i < cores; i++)
-	{
 		quantum_clock[i] = -1;
-		core_timing_diagram[i] = malloc(core_timing_diagram_size + 1);
-		core_timing_diagram[i][0] = '\0';
-	}
 
 	while (active_jobs > 0)
 	{
-		printf("=== [TIME %d] ===\n", time);
+		LOG(LOG_INFO, "=== [TIME %d] ===\n", time);
 
 		/*
 		 * 1. Check if any jobs finished in the last time unit.
@@ -252,7 +386,7 @@ int main(int argc, char **argv)
 				// Notify the scheduler has finished
 				int job_id = jobs[i].job_id;
 				int core_id = jobs[i].core_id;
-				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
+				int new_job_id = scheduler_job_finished_r(scheduler, jobs[i].core_id, jobs[i].job_id, time);
 
 				if (scheme == RR)
 					quantum_clock[jobs[i].core_id] = quantum;
@@ -267,14 +401,14 @@ int main(int argc, char **argv)
 				// Set the new job
 				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
 				{
-					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+					LOG(LOG_ERROR, "The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
 					print_available_jobs(jobs, active_jobs);
 					return 3;
 				}
 				else
 				{
-					printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					LOG(LOG_INFO, "Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+					show_queue(scheduler);
 				}
 			}
 		}
@@ -301,7 +435,7 @@ int main(int argc, char **argv)
 							// Notify the scheduler the quantum has expired
 							int core_id = jobs[j].core_id;
 							int old_job_id = jobs[j].job_id;
-							int new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
+							int new_job_id = scheduler_quantum_expired_r(scheduler, jobs[j].core_id, time);
 
 							jobs[j].core_id = -1;
 
@@ -310,14 +444,14 @@ int main(int argc, char **argv)
 							// Set the new job
 							if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
 							{
-								printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
+								LOG(LOG_ERROR, "The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
 								print_available_jobs(jobs, active_jobs);
 								return 3;
 							}
 							else
 							{
-								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
-								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+								LOG(LOG_INFO, "Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
+								show_queue(scheduler);
 							}
 
 							break;
@@ -335,15 +469,15 @@ int main(int argc, char **argv)
 		{
 			if (jobs[i].arrival_time == time)
 			{
-				int new_job_core_id = scheduler_new_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
+				int new_job_core_id = scheduler_new_job_r(scheduler, jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
 				jobs[i].arrived = 1;
 				jobs_alive++;
 
 				if (new_job_core_id >= 0 && new_job_core_id < cores)
 				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+					LOG(LOG_INFO, "A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
 							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					show_queue(scheduler);
 
 					// Find if anyone is currently using the core.
 					for (j = 0; j < active_jobs; j++)
@@ -358,13 +492,13 @@ int main(int argc, char **argv)
 				}
 				else if (new_job_core_id == -1)
 				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+					LOG(LOG_INFO, "A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
 							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					show_queue(scheduler);
 				}
 				else
 				{
-					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
+					LOG(LOG_ERROR, "The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
 					print_available_cores(cores);
 					return 3;
 				}
@@ -375,11 +509,10 @@ int main(int argc, char **argv)
 		/*
 		 * 4. Run the time unit.
 		 */
-		char time_string[cores][11];
 		int cores_working = 0;
 
 		for (i = 0; i < cores; i++)
-			time_string[i][0] = '\0';
+			core_job[i] = -1;
 
 		for (i = 0; i < active_jobs; i++)
 		{
@@ -389,60 +522,28 @@ int main(int argc, char **argv)
 				jobs[i].run_time--;
 				quantum_clock[jobs[i].core_id]--;
 
-				assert(time_string[jobs[i].core_id][0] == '\0');
-
-				if (jobs[i].job_id < 10)
-					sprintf(time_string[jobs[i].core_id], "%d", jobs[i].job_id);
-				else if (jobs[i].job_id < 10 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 + 'a');
-				else if (jobs[i].job_id < 10 + 26 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 - 26 + 'A');
-				else
-					snprintf(time_string[jobs[i].core_id], 10, "(%d)", jobs[i].job_id);
-			}
-		}
-
-		for (i = 0; i < cores; i++)
-		{
-			// If the core is idle, print a '-'
-			if (time_string[i][0] == '\0')
-				strcpy(time_string[i], "-");
-
-			// Ensure we have enough memory
-			while (strlen(core_timing_diagram[i]) + strlen(time_string[i]) >= (unsigned int)core_timing_diagram_size)
-			{
-				core_timing_diagram_size *= 2;
+				assert(core_job[jobs[i].core_id] == -1);
+				core_job[jobs[i].core_id] = jobs[i].job_id;
 
-				for (j = 0; j < cores; j++)
-				{
-					core_timing_diagram[j] = realloc(core_timing_diagram[j], core_timing_diagram_size + 1);
-
-					if (core_timing_diagram[j] == NULL)
-					{
-						fprintf(stderr, "Out of memory.\n");
-						return 3;
-					}
-				}
+				// Extends the core's last run in O(1); idle time is left out
+				diagram_add(&diagram, jobs[i].core_id, jobs[i].job_id, time, 1);
 			}
-
-			strcat( core_timing_diagram[i], time_string[i] );
 		}
 
 
 		/*
 		 * 5. Print data!
 		 */
-		printf("At the end of time unit %d...\n", time);
+		if (LOG_ENABLED(LOG_INFO))
+		{
+			printf("At the end of time unit %d...\n", time);
 
-		for (i = 0; i < cores; i++)
-			printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
+			print_diagram(&diagram, cores, time + 1);
 
-		printf("\n");
+			printf("\n");
 
-		printf("  Queue: ");
-		scheduler_show_queue();
-		printf("\n");
-		printf("\n");
+			show_queue(scheduler);
+		}
 
 
 		/*
@@ -452,7 +553,7 @@ int main(int argc, char **argv)
 		 */
 		if (jobs_alive > 0 && cores_working == 0)
 		{
-			printf("All cores are idle and at least one job remains unscheduled.\n");
+			LOG(LOG_ERROR, "All cores are idle and at least one job remains unscheduled.\n");
 			print_available_jobs(jobs, active_jobs);
 			return 3;
 		}
@@ -465,22 +566,29 @@ int main(int argc, char **argv)
 	}
 
 
-	printf("FINAL TIMING DIAGRAM:\n");
-	for (i = 0; i < cores; i++)
-		printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
+	if (LOG_ENABLED(LOG_INFO))
+	{
+		printf("FINAL TIMING DIAGRAM:\n");
+		print_diagram(&diagram, cores, time);
 
-	printf("\n");
-	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time());
-	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
-	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
+		printf("\n");
+	}
+	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time_r(scheduler));
+	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time_r(scheduler));
+	printf("Average Response Time: %.2f\n", scheduler_average_response_time_r(scheduler));
+
+	if (save_diagram(&diagram, time, diagram_name, json_name) != 0)
+		return 2;
 
-	scheduler_clean_up();
+	scheduler_destroy(scheduler);
+	diagram_destroy(&diagram);
+	if (event_log != NULL)
+		fclose(event_log);
 
 
 	free(quantum_clock);
-	for (i=0; i < cores; i++)
-		free(core_timing_diagram[i]);
-	free(core_timing_diagram);
+	free(core_job);
+	trace_close(&trace);
 	free(jobs);
 
 	return 0;
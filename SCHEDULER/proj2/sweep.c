@@ -0,0 +1,269 @@
+/** @file sweep.c
+
+  Runs the simulator over every combination of traces, core counts and
+  schemes and writes the metrics of all of them as one CSV.
+
+  Every combination is simulated with libsimulator on a pool of worker
+  threads, each simulation with its own scheduler_t and with the
+  scheduler's commentary turned off. -T steps through time one unit at a
+  time as simulator.c does instead of jumping from event to event.
+
+  Traces, CSV or binary ones made by traceconv, are read once and shared.
+  Rows come out in the order the combinations are listed, however the
+  threads happen to finish: trace, cores, scheme, RR quantum (0 for the
+  other schemes), jobs, the three averages, the time the last job finished
+  and the fraction of core time spent running jobs.
+
+  "rr" in the scheme list stands for RR with every quantum given with -q;
+  "rr2" and so on ask for one quantum.
+
+  Usage: sweep [-j threads] [-T] [-c cores,...] [-s schemes,...] [-q quanta,...] trace...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "libsimulator/libsimulator.h"
+#include "libsimulator/trace.h"
+
+#define MAX_LIST 64
+
+/**
+  One combination to simulate and, once a worker is done with it, its
+  results.
+ */
+typedef struct task_t
+{
+    const trace_t *trace;
+    int cores;
+    scheme_t scheme;
+    int quantum;
+    simulator_result_t result;
+} task_t;
+
+/**
+  The work shared by every thread: the tasks and the index of the next one
+  nobody has taken yet.
+ */
+typedef struct sweep_t
+{
+    task_t *tasks;
+    int num_tasks;
+    int next_task;
+    int ticks;
+} sweep_t;
+
+static const char *scheme_names[] = {"fcfs", "sjf", "psjf", "pri", "ppri", "rr"};
+
+static void print_usage(char *program_name)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [-T] [-c cores,...] [-s schemes,...] [-q quanta,...] trace...\n", program_name);
+    fprintf(stderr, "       %s -c 1,2,4 -s fcfs,sjf,rr -q 1,2,4 examples/proc1.csv examples/proc2.csv\n", program_name);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr, rr#\n");
+}
+
+/**
+  Splits a comma separated list of positive numbers into values.
+
+  @return the number of values, or -1 if the list is malformed
+ */
+static int parse_numbers(char *list, int *values)
+{
+    int n = 0;
+    char *save, *item;
+
+    for (item = strtok_r(list, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        if (n == MAX_LIST || atoi(item) <= 0)
+            return -1;
+        values[n++] = atoi(item);
+    }
+    return n > 0 ? n : -1;
+}
+
+/**
+  Maps and reads a trace. Exits if the file cannot be read.
+ */
+static void load_trace(trace_t *trace, const char *file_name)
+{
+    if (trace_open(trace, file_name) != 0 || trace_load(trace) != 0)
+    {
+        fprintf(stderr, "%s\n", trace->error);
+        exit(2);
+    }
+}
+
+static void *worker(void *arg)
+{
+    sweep_t *sweep = arg;
+    int i;
+
+    while ((i = __atomic_fetch_add(&sweep->next_task, 1, __ATOMIC_RELAXED)) < sweep->num_tasks)
+    {
+        task_t *task = &sweep->tasks[i];
+        scheduler_t *s = scheduler_create(task->cores, task->scheme);
+        void (*run)(scheduler_t *, const simulator_job_t *, int, int, scheme_t, int, diagram_t *, simulator_result_t *);
+
+        scheduler_set_quiet(s, true);
+        run = sweep->ticks ? simulator_run_ticks : simulator_run;
+        run(s, task->trace->jobs, task->trace->num_jobs, task->cores, task->scheme, task->quantum, NULL, &task->result);
+        scheduler_destroy(s);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    char default_schemes[] = "fcfs,sjf,psjf,pri,ppri,rr";
+    int cores[MAX_LIST] = {1, 2, 4}, quanta[MAX_LIST] = {1, 2, 4};
+    int num_cores = 3, num_quanta = 3;
+    char *schemes = default_schemes;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int ticks = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "j:c:s:q:T")) != -1)
+    {
+        switch (c)
+        {
+            case 'j': threads = atoi(optarg); break;
+            case 'T': ticks = 1; break;
+            case 'c': num_cores = parse_numbers(optarg, cores); break;
+            case 'q': num_quanta = parse_numbers(optarg, quanta); break;
+            case 's': schemes = optarg; break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+        if (num_cores < 0 || num_quanta < 0 || threads <= 0)
+        {
+            fprintf(stderr, "Option -%c requires positive numbers.\n", c);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind == argc)
+    {
+        fprintf(stderr, "At least one input file is required.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    /* Each scheme entry becomes one or more (scheme, quantum) pairs */
+    scheme_t run_schemes[MAX_LIST * MAX_LIST];
+    int run_quanta[MAX_LIST * MAX_LIST];
+    int num_runs = 0;
+    char *save, *name;
+    int i, k;
+
+    for (name = strtok_r(schemes, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+    {
+        if (strncasecmp(name, "RR", 2) == 0 && name[2] == '\0')
+        {
+            for (i = 0; i < num_quanta && num_runs < MAX_LIST * MAX_LIST; i++)
+            {
+                run_schemes[num_runs] = RR;
+                run_quanta[num_runs++] = quanta[i];
+            }
+            continue;
+        }
+
+        int scheme = -1, quantum = 0;
+        if (strcasecmp(name, "FCFS") == 0) { scheme = FCFS; }
+        else if (strcasecmp(name, "SJF") == 0) { scheme = SJF; }
+        else if (strcasecmp(name, "PSJF") == 0) { scheme = PSJF; }
+        else if (strcasecmp(name, "PRI") == 0) { scheme = PRI; }
+        else if (strcasecmp(name, "PPRI") == 0) { scheme = PPRI; }
+        else if (strncasecmp(name, "RR", 2) == 0 && atoi(name + 2) > 0)
+        {
+            scheme = RR;
+            quantum = atoi(name + 2);
+        }
+
+        if (scheme == -1 || num_runs == MAX_LIST * MAX_LIST)
+        {
+            fprintf(stderr, "Unknown scheme \"%s\".\n", name);
+            print_usage(argv[0]);
+            return 1;
+        }
+        run_schemes[num_runs] = scheme;
+        run_quanta[num_runs++] = quantum;
+    }
+
+    int num_traces = argc - optind;
+    trace_t *traces = malloc(num_traces * sizeof(trace_t));
+    for (i = 0; i < num_traces; i++)
+        load_trace(&traces[i], argv[optind + i]);
+
+    sweep_t sweep;
+    sweep.num_tasks = num_traces * num_cores * num_runs;
+    sweep.tasks = malloc(sweep.num_tasks * sizeof(task_t));
+    sweep.next_task = 0;
+    sweep.ticks = ticks;
+
+    task_t *task = sweep.tasks;
+    for (i = 0; i < num_traces; i++)
+    {
+        for (c = 0; c < num_cores; c++)
+        {
+            for (k = 0; k < num_runs; k++, task++)
+            {
+                task->trace = &traces[i];
+                task->cores = cores[c];
+                task->scheme = run_schemes[k];
+                task->quantum = run_quanta[k];
+            }
+        }
+    }
+
+    if (threads > sweep.num_tasks)
+        threads = sweep.num_tasks;
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (i = 0; i < threads && workers != NULL; i++)
+        if (pthread_create(&workers[started], NULL, worker, &sweep) == 0)
+            started++;
+    // Short of memory for any thread stacks, the tasks are run here
+    if (started == 0)
+        worker(&sweep);
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    int status = 0;
+
+    printf("trace,cores,scheme,quantum,jobs,avg_waiting,avg_turnaround,avg_response,makespan,utilization\n");
+    for (i = 0; i < sweep.num_tasks; i++)
+    {
+        task = &sweep.tasks[i];
+        simulator_result_t *r = &task->result;
+        if (r->status != 0)
+        {
+            fprintf(stderr, "%s on %d core(s) with %s%.0d: %s\n",
+                    task->trace->name, task->cores, scheme_names[task->scheme], task->quantum,
+                    r->status == 4 ? "not enough memory" : "the scheduler made an invalid choice");
+            if (status != 4)
+                status = r->status;
+            continue;
+        }
+
+        printf("%s,%d,%s,%d,%d,%.2f,%.2f,%.2f,%d,%.3f\n",
+               task->trace->name, task->cores, scheme_names[task->scheme], task->quantum,
+               task->trace->num_jobs, r->waiting, r->turnaround, r->response,
+               r->makespan, r->makespan > 0 ? (double)r->busy / ((double)r->makespan * task->cores) : 0.0);
+    }
+
+    for (i = 0; i < num_traces; i++)
+        trace_close(&traces[i]);
+    free(traces);
+    free(sweep.tasks);
+    free(workers);
+
+    return status;
+}
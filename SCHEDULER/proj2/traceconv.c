@@ -0,0 +1,100 @@
+/** @file traceconv.c
+
+  Converts a trace between the CSV format and the binary formats
+  described in libsimulator/trace.h. The simulator and sweep read any of
+  them; a binary trace has nothing to parse, so a large trace that is
+  simulated many times is worth converting once.
+
+  The output is binary when the input is CSV and CSV otherwise, unless -f
+  asks for csv, bin or varint. Jobs are copied one at a time, so the whole
+  trace is never held in memory. An output of "-" is standard output.
+
+  Usage: traceconv [-f csv|bin|varint] <input> <output>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "libsimulator/trace.h"
+
+static void print_usage(char *program_name)
+{
+    fprintf(stderr, "Usage: %s [-f csv|bin|varint] <input> <output>\n", program_name);
+    fprintf(stderr, "       %s examples/proc1.csv proc1.bin\n", program_name);
+}
+
+int main(int argc, char **argv)
+{
+    int c, format = -1;
+
+    while ((c = getopt(argc, argv, "f:")) != -1)
+    {
+        if (c != 'f')
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        if (strcasecmp(optarg, "csv") == 0) { format = TRACE_CSV; }
+        else if (strcasecmp(optarg, "bin") == 0) { format = TRACE_BINARY; }
+        else if (strcasecmp(optarg, "varint") == 0) { format = TRACE_VARINT; }
+        else
+        {
+            fprintf(stderr, "Option -f requires one of csv, bin or varint.\n");
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *output_name = argv[optind + 1];
+    trace_t trace;
+
+    if (trace_open(&trace, argv[optind]) != 0)
+    {
+        fprintf(stderr, "%s\n", trace.error);
+        return 2;
+    }
+    if (format == -1)
+        format = trace.format == TRACE_CSV ? TRACE_BINARY : TRACE_CSV;
+
+    FILE *file = strcmp(output_name, "-") == 0 ? stdout : fopen(output_name, "wb");
+    trace_writer_t writer;
+    simulator_job_t job;
+    int status = 0, got;
+
+    if (file == NULL || trace_writer_open(&writer, file, format, trace.num_jobs) != 0)
+    {
+        fprintf(stderr, "Unable to write file \"%s\".\n", output_name);
+        trace_close(&trace);
+        return 2;
+    }
+
+    while ((got = trace_next(&trace, &job)) == 1)
+    {
+        if (trace_write(&writer, &job) != 0)
+            break;
+    }
+
+    if (got == -1)
+    {
+        fprintf(stderr, "%s\n", trace.error);
+        status = 2;
+    }
+    else if (got == 1 || fflush(file) != 0 || ferror(file) || (file != stdout && fclose(file) != 0))
+    {
+        fprintf(stderr, "Unable to write file \"%s\".\n", output_name);
+        status = 2;
+    }
+
+    trace_close(&trace);
+    return status;
+}
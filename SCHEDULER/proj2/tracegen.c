@@ -0,0 +1,383 @@
+/** @file tracegen.c
+
+  Generates synthetic traces for the simulator and sweep, from a thousand
+  jobs to hundreds of millions of them.
+
+  Arrivals are either a Poisson process with -r jobs per time unit, or
+  bursty: bursts of on average -B jobs (geometrically distributed) that
+  arrive together, with the bursts themselves a Poisson process at
+  -r / -B bursts per time unit, so the mean rate is still -r.
+
+  The scheduler needs every job to arrive at a different time, so a job
+  that would arrive in the same time unit as the one before it arrives in
+  the next free one instead. A burst is spread over consecutive time
+  units, and a rate much above 1 is held to about one job per time unit.
+
+  Run times have mean -m and are Pareto distributed with shape -k
+  (default 1.5, which must be above 1 for the mean to exist), lognormal
+  with sigma -k (default 1), or exponential. They are rounded to whole
+  time units, at least 1.
+
+  Priorities are drawn from -P: "uniform:N" for 0 to N - 1 equally likely,
+  "zipf:N:S" for 0 to N - 1 with weights 1 / (p + 1)^S, or a list of
+  weights "w0,w1,..." for priority p with weight wp. The default is
+  uniform:10.
+
+  The same options and -s seed always give the same trace. Jobs are
+  written as they are generated, in order of arrival, so the trace is
+  never held in memory and can be streamed with simulator -S.
+
+  Usage: tracegen [-n jobs] [-s seed] [-a poisson|bursty] [-r rate] [-B burst]
+                  [-t pareto|lognormal|exp] [-m mean] [-k shape] [-P priorities]
+                  [-f csv|bin|varint] [-o output]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "libsimulator/trace.h"
+
+#define MAX_PRIORITIES 1024
+
+typedef enum { POISSON, BURSTY } arrivals_t;
+typedef enum { PARETO, LOGNORMAL, EXPONENTIAL } runtimes_t;
+
+/**
+  xoshiro256** seeded through splitmix64, so a seed gives the same numbers
+  on every platform, unlike rand().
+ */
+typedef struct rng_t
+{
+    uint64_t s[4];
+} rng_t;
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(rng_t *rng, uint64_t seed)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        rng->s[i] = splitmix64(&seed);
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t rng_next(rng_t *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/** A number in (0, 1], safe to take the log of */
+static double rng_uniform(rng_t *rng)
+{
+    return ((rng_next(rng) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_exponential(rng_t *rng, double mean)
+{
+    return -log(rng_uniform(rng)) * mean;
+}
+
+static double rng_normal(rng_t *rng)
+{
+    return sqrt(-2.0 * log(rng_uniform(rng))) * cos(2.0 * M_PI * rng_uniform(rng));
+}
+
+/**
+  Everything that decides the trace, as parsed from the command line.
+ */
+typedef struct workload_t
+{
+    arrivals_t arrivals;
+    double rate;
+    double burst;
+
+    runtimes_t runtimes;
+    double mean;
+    double shape;
+
+    double weights[MAX_PRIORITIES];
+    int num_priorities;
+} workload_t;
+
+static void print_usage(char *program_name)
+{
+    fprintf(stderr, "Usage: %s [-n jobs] [-s seed] [-a poisson|bursty] [-r rate] [-B burst]\n", program_name);
+    fprintf(stderr, "       [-t pareto|lognormal|exp] [-m mean] [-k shape] [-P priorities]\n");
+    fprintf(stderr, "       [-f csv|bin|varint] [-o output]\n");
+    fprintf(stderr, "       %s -n 1000000 -s 7 -a bursty -t pareto -f bin -o big.bin\n", program_name);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "-r is jobs per time unit (default 0.1), -B the mean burst size (default 10)\n");
+    fprintf(stderr, "-m is the mean run time (default 100), -k the Pareto shape or lognormal sigma\n");
+    fprintf(stderr, "-P is uniform:N, zipf:N:S or a list of weights, one per priority from 0\n");
+}
+
+/**
+  Fills in the priority weights from a -P argument.
+
+  @return 0, or -1 if the argument does not make sense
+ */
+static int parse_priorities(workload_t *workload, const char *arg)
+{
+    int n, i;
+    double s;
+    char *end;
+
+    if (strncasecmp(arg, "uniform:", 8) == 0)
+    {
+        n = strtol(arg + 8, &end, 10);
+        if (*end != '\0' || n <= 0 || n > MAX_PRIORITIES)
+            return -1;
+        for (i = 0; i < n; i++)
+            workload->weights[i] = 1.0;
+    }
+    else if (strncasecmp(arg, "zipf:", 5) == 0)
+    {
+        n = strtol(arg + 5, &end, 10);
+        if (*end != ':' || n <= 0 || n > MAX_PRIORITIES)
+            return -1;
+        s = strtod(end + 1, &end);
+        if (*end != '\0' || s < 0)
+            return -1;
+        for (i = 0; i < n; i++)
+            workload->weights[i] = pow(i + 1, -s);
+    }
+    else
+    {
+        for (n = 0; *arg != '\0'; n++)
+        {
+            if (n == MAX_PRIORITIES)
+                return -1;
+            workload->weights[n] = strtod(arg, &end);
+            if (end == arg || workload->weights[n] < 0 || (*end != ',' && *end != '\0'))
+                return -1;
+            arg = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    // Keep running totals, for draw_priority to search
+    for (i = 1; i < n; i++)
+        workload->weights[i] += workload->weights[i - 1];
+    workload->num_priorities = n;
+    return n > 0 && workload->weights[n - 1] > 0 ? 0 : -1;
+}
+
+static int draw_priority(const workload_t *workload, rng_t *rng)
+{
+    double x = (1.0 - rng_uniform(rng)) * workload->weights[workload->num_priorities - 1];
+    int lo = 0, hi = workload->num_priorities - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (x < workload->weights[mid])
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+static int draw_run_time(const workload_t *workload, rng_t *rng)
+{
+    double x;
+
+    if (workload->runtimes == PARETO)
+        x = workload->mean * (workload->shape - 1) / workload->shape * pow(rng_uniform(rng), -1.0 / workload->shape);
+    else if (workload->runtimes == LOGNORMAL)
+        x = exp(log(workload->mean) - workload->shape * workload->shape / 2 + workload->shape * rng_normal(rng));
+    else
+        x = rng_exponential(rng, workload->mean);
+
+    if (x < 1)
+        return 1;
+    if (x >= INT_MAX)
+        return INT_MAX;
+    return (int)(x + 0.5);
+}
+
+/** How many jobs the next burst has; geometric with mean workload->burst */
+static int draw_burst(const workload_t *workload, rng_t *rng)
+{
+    double x;
+
+    if (workload->burst <= 1)
+        return 1;
+    x = 1 + floor(log(rng_uniform(rng)) / log(1 - 1 / workload->burst));
+    return x >= INT_MAX ? INT_MAX : (int)x;
+}
+
+int main(int argc, char **argv)
+{
+    workload_t workload = {POISSON, 0.1, 10, PARETO, 100, 0, {0}, 0};
+    unsigned long long seed = 1;
+    long long num_jobs = 1000;
+    int c, bad = 0, format = TRACE_CSV;
+    const char *output_name = "-";
+
+    parse_priorities(&workload, "uniform:10");
+
+    while ((c = getopt(argc, argv, "n:s:a:r:B:t:m:k:P:f:o:")) != -1)
+    {
+        char *end = NULL;
+
+        switch (c)
+        {
+            case 'n':
+                num_jobs = strtoll(optarg, &end, 10);
+                break;
+
+            case 's':
+                seed = strtoull(optarg, &end, 10);
+                break;
+
+            case 'a':
+                if (strcasecmp(optarg, "poisson") == 0) { workload.arrivals = POISSON; }
+                else if (strcasecmp(optarg, "bursty") == 0) { workload.arrivals = BURSTY; }
+                else { bad = 1; }
+                break;
+
+            case 'r':
+                workload.rate = strtod(optarg, &end);
+                break;
+
+            case 'B':
+                workload.burst = strtod(optarg, &end);
+                break;
+
+            case 't':
+                if (strcasecmp(optarg, "pareto") == 0) { workload.runtimes = PARETO; }
+                else if (strcasecmp(optarg, "lognormal") == 0) { workload.runtimes = LOGNORMAL; }
+                else if (strcasecmp(optarg, "exp") == 0) { workload.runtimes = EXPONENTIAL; }
+                else { bad = 1; }
+                break;
+
+            case 'm':
+                workload.mean = strtod(optarg, &end);
+                break;
+
+            case 'k':
+                workload.shape = strtod(optarg, &end);
+                bad = workload.shape <= 0;
+                break;
+
+            case 'P':
+                if (parse_priorities(&workload, optarg) != 0)
+                {
+                    fprintf(stderr, "Option -P requires uniform:N, zipf:N:S or a list of weights.\n");
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+
+            case 'f':
+                if (strcasecmp(optarg, "csv") == 0) { format = TRACE_CSV; }
+                else if (strcasecmp(optarg, "bin") == 0) { format = TRACE_BINARY; }
+                else if (strcasecmp(optarg, "varint") == 0) { format = TRACE_VARINT; }
+                else { bad = 1; }
+                break;
+
+            case 'o':
+                output_name = optarg;
+                break;
+
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+
+        if ((end != NULL && (*end != '\0' || end == optarg)) || bad)
+        {
+            fprintf(stderr, "Option -%c does not accept \"%s\".\n", c, optarg);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (workload.shape == 0)
+        workload.shape = workload.runtimes == PARETO ? 1.5 : 1.0;
+
+    if (optind != argc || num_jobs <= 0 || num_jobs > INT_MAX || workload.rate <= 0 || workload.burst < 1
+        || workload.mean < 1 || (workload.runtimes == PARETO && workload.shape <= 1))
+    {
+        fprintf(stderr, "Jobs, -r and -k need to be positive, -B and -m at least 1 and a Pareto -k above 1.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *file = strcmp(output_name, "-") == 0 ? stdout : fopen(output_name, "wb");
+    trace_writer_t writer;
+
+    if (file == NULL || trace_writer_open(&writer, file, format, num_jobs) != 0)
+    {
+        fprintf(stderr, "Unable to write file \"%s\".\n", output_name);
+        return 2;
+    }
+
+    rng_t rng;
+    simulator_job_t job;
+    double time = 0;
+    long long i, arrival = -1;
+    int burst_left = 0;
+
+    rng_seed(&rng, seed);
+    for (i = 0; i < num_jobs; i++)
+    {
+        if (workload.arrivals == POISSON)
+            time += rng_exponential(&rng, 1 / workload.rate);
+        else if (burst_left-- == 0)
+        {
+            time += rng_exponential(&rng, workload.burst / workload.rate);
+            burst_left = draw_burst(&workload, &rng) - 1;
+        }
+
+        if (time < INT_MAX)
+            arrival = (long long)time > arrival ? (long long)time : arrival + 1;
+        if (time >= INT_MAX || arrival >= INT_MAX)
+        {
+            fprintf(stderr, "Arrival times run past %d after %lld job(s); raise -r or lower -n.\n", INT_MAX, i);
+            return 2;
+        }
+
+        job.job_id = i;
+        job.arrival_time = (int)arrival;
+        job.run_time = draw_run_time(&workload, &rng);
+        job.priority = draw_priority(&workload, &rng);
+
+        if (trace_write(&writer, &job) != 0)
+            break;
+    }
+
+    if (i < num_jobs || fflush(file) != 0 || ferror(file) || (file != stdout && fclose(file) != 0))
+    {
+        fprintf(stderr, "Unable to write file \"%s\".\n", output_name);
+        return 2;
+    }
+    return 0;
+}